@@ -9,9 +9,18 @@ CONFIG += c++17
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 
+# opencv
+INCLUDEPATH += D:/Lib/OpenCV-MinGW-Build-OpenCV-4.5.5-x64/include
+LIBS += -LD:/Lib/OpenCV-MinGW-Build-OpenCV-4.5.5-x64/x64/mingw/lib
+LIBS += -lopencv_core455 -lopencv_imgproc455 -lopencv_imgcodecs455 -lopencv_objdetect455
+
+
+# 共用协议模块
+include(../common/common.pri)
 
 SOURCES += \
     contest.cpp \
+    custom_controls/facecropper.cpp \
     custom_controls/facedetection.cpp \
     network_modules/apiclient.cpp \
     custom_controls/avatarcrop.cpp \
@@ -28,6 +37,7 @@ SOURCES += \
 
 HEADERS += \
     contest.h \
+    custom_controls/facecropper.h \
     custom_controls/facedetection.h \
     network_modules/apiclient.h \
     custom_controls/avatarcrop.h \
@@ -0,0 +1,88 @@
+#include "facecropper.h"
+
+#include <QSettings>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <cmath>
+
+#include "qdebug.h"
+
+FaceCropper::FaceCropper()
+{
+    // 使用配置文件，默认与服务器相同的 Haar 级联模型
+    const QString cascadePath = QSettings().value("face/cascade", "D:/Lib/OpenCV-MinGW-Build-OpenCV-4.5.5-x64/etc/haarcascades/haarcascade_frontalface_default.xml").toString();
+    if (!cascade.load(cascadePath.toStdString()))
+    {
+        qDebug() << "Failed to load Haar Cascade, uploading full frames:" << cascadePath;
+    }
+}
+
+bool FaceCropper::isReady() const
+{
+    return !cascade.empty();
+}
+
+bool FaceCropper::crop(const QImage& frame, QByteArray& encoded, double& confidence)
+{
+    if (cascade.empty() || frame.isNull())
+    {
+        return false;
+    }
+
+    // QImage 转为 BGR，cv::Mat 直接引用 QImage 的数据
+    const QImage bgrImage = frame.convertToFormat(QImage::Format_BGR888);
+    const cv::Mat bgr(bgrImage.height(), bgrImage.width(), CV_8UC3,
+                      const_cast<uchar*>(bgrImage.constBits()), size_t(bgrImage.bytesPerLine()));
+
+    // 缩小到工作宽度检测
+    const double scale = std::min(1.0, double(WORKING_WIDTH) / bgr.cols);
+    cv::Mat small;
+    if (scale < 1.0)
+    {
+        cv::resize(bgr, small, cv::Size(), scale, scale, cv::INTER_AREA);
+    }
+    else
+    {
+        small = bgr;
+    }
+
+    cv::Mat gray;
+    cv::cvtColor(small, gray, cv::COLOR_BGR2GRAY);
+    cv::equalizeHist(gray, gray);
+
+    const int minSide = std::max(24, int(std::lround(30 * scale)));
+    std::vector<cv::Rect> faces;
+    std::vector<int> rejectLevels;
+    std::vector<double> levelWeights;
+    cascade.detectMultiScale(gray, faces, rejectLevels, levelWeights, 1.1, 3, 0, cv::Size(minSide, minSide), cv::Size(), true);
+
+    // 没有或有多张人脸时交给服务器处理整帧，由服务器给出具体原因
+    if (faces.size() != 1)
+    {
+        return false;
+    }
+
+    // 映射回原图坐标，在原图上裁剪
+    const cv::Rect& box = faces[0];
+    cv::Rect mapped(int(std::floor(box.x / scale)), int(std::floor(box.y / scale)),
+                    int(std::ceil(box.width / scale)), int(std::ceil(box.height / scale)));
+    mapped &= cv::Rect(0, 0, bgr.cols, bgr.rows);
+    if (mapped.empty())
+    {
+        return false;
+    }
+
+    cv::Mat face;
+    cv::resize(bgr(mapped), face, cv::Size(FACE_SIZE, FACE_SIZE));
+
+    std::vector<uchar> buffer;
+    if (!cv::imencode(".jpg", face, buffer, {cv::IMWRITE_JPEG_QUALITY, JPEG_QUALITY}))
+    {
+        return false;
+    }
+
+    encoded = QByteArray(reinterpret_cast<const char*>(buffer.data()), int(buffer.size()));
+    confidence = levelWeights.empty() ? 0.0 : levelWeights[0];
+    return true;
+}
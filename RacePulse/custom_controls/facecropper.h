@@ -0,0 +1,29 @@
+#ifndef FACECROPPER_H
+#define FACECROPPER_H
+
+#include <QByteArray>
+#include <QImage>
+#include <opencv2/objdetect.hpp>
+
+// 客户端人脸检测与裁剪
+// 与服务器使用相同的检测方式（缩小到工作宽度检测，再映射回原图裁剪），
+// 只上传 112x112 的人脸，检测失败时由调用方改为上传整帧
+class FaceCropper
+{
+public:
+    FaceCropper();
+
+    bool isReady() const;
+
+    // 画面中恰好有一张人脸时返回 true，输出 JPEG 编码的人脸与检测置信度
+    bool crop(const QImage& frame, QByteArray& encoded, double& confidence);
+
+private:
+    cv::CascadeClassifier cascade;
+
+    static constexpr int WORKING_WIDTH = 320; // 与服务器 face/detect_width 默认值一致
+    static constexpr int FACE_SIZE = 112;     // 特征模型的输入尺寸
+    static constexpr int JPEG_QUALITY = 95;
+};
+
+#endif // FACECROPPER_H
@@ -3,6 +3,7 @@
 #include <qmessagebox.h>
 
 #include <QBuffer>
+#include <QDateTime>
 
 #include "custom_controls/dialog.h"
 #include "qevent.h"
@@ -18,6 +19,7 @@ FaceDetection::FaceDetection(ApiClient* apiclient, QString mode, QWidget* parent
     , videoSink(new QVideoSink(this))
     , timer(new QTimer(this))
     , mediaPlayer(new QMediaPlayer(this))
+    , streamTimer(new QTimer(this))
 
 {
     ui->setupUi(this);
@@ -51,6 +53,7 @@ FaceDetection::FaceDetection(ApiClient* apiclient, QString mode, QWidget* parent
     timer->start(100); // 每100ms传一次
 
     connect(m_apiclient, &ApiClient::dataReceived, this, &FaceDetection::recvFace);
+    connect(streamTimer, &QTimer::timeout, this, &FaceDetection::sendStreamFrame);
 }
 
 FaceDetection::~FaceDetection()
@@ -121,14 +124,6 @@ void FaceDetection::onNewFrame(const QVideoFrame& frame)
 
 void FaceDetection::sendFace(const QImage image)
 {
-    // 将 QImage 转换为 PNG 格式的字节数组
-    QByteArray byteArray;
-    QBuffer buffer(&byteArray);
-    buffer.open(QIODevice::WriteOnly);
-    image.save(&buffer, "PNG");
-
-    // 将字节数组转换为 Base64 编码字符串
-    QString base64Image = byteArray.toBase64();
     QString usernum = m_apiclient->getUsernum();
 
     if (usernum == nullptr)
@@ -137,15 +132,95 @@ void FaceDetection::sendFace(const QImage image)
         return;
     }
 
-    // 创建 QJsonObject，并将 Base64 编码字符串存入其中
+    // 图片作为附件发送，旧协议下由 ApiClient 转为 Base64 字段
     QJsonObject jsonObject;
     jsonObject["tag"] = "face";
     jsonObject["mode"] = m_mode;
     jsonObject["usernum"] = usernum;
-    jsonObject["face"] = base64Image;
+    if (streaming)
+    {
+        jsonObject["stream"] = streamId;
+    }
+
+    Attachments attachments;
+
+    // 本地检测到人脸时只上传 112x112 的裁剪结果，服务器跳过检测
+    QByteArray faceCrop;
+    double confidence = 0.0;
+    if (faceCropper.crop(image, faceCrop, confidence))
+    {
+        jsonObject["crop_confidence"] = confidence;
+        attachments.insert("face_crop", faceCrop);
+    }
+    else
+    {
+        // 本地未检测到唯一人脸，上传整帧由服务器检测；流式验证只上传低分辨率的 JPEG
+        QByteArray byteArray;
+        QBuffer buffer(&byteArray);
+        buffer.open(QIODevice::WriteOnly);
+        if (streaming && image.width() > STREAM_WIDTH)
+        {
+            image.scaledToWidth(STREAM_WIDTH, Qt::SmoothTransformation).save(&buffer, "JPG", 85);
+        }
+        else
+        {
+            image.save(&buffer, "PNG");
+        }
+        attachments.insert("face", byteArray);
+    }
 
     // 调用 sendJsonRequest 发送
-    m_apiclient->sendJsonRequest(jsonObject);
+    m_apiclient->sendJsonRequest(jsonObject, attachments);
+}
+
+void FaceDetection::startStream()
+{
+    streamId = QDateTime::currentMSecsSinceEpoch();
+    streaming = true;
+    streamClock.start();
+    sendStreamFrame();
+    streamTimer->start(STREAM_INTERVAL_MS);
+}
+
+void FaceDetection::sendStreamFrame()
+{
+    if (!streaming)
+    {
+        return;
+    }
+
+    // 时间用完仍未通过，通知服务器结束，服务器处理完在途的帧后回复失败
+    if (streamClock.elapsed() >= STREAM_DURATION_MS)
+    {
+        stopStream(true);
+        return;
+    }
+
+    if (!currentFrame.isNull())
+    {
+        sendFace(currentFrame);
+    }
+}
+
+void FaceDetection::stopStream(bool sendEnd)
+{
+    streamTimer->stop();
+    if (!streaming)
+    {
+        return;
+    }
+    streaming = false;
+
+    if (sendEnd)
+    {
+        QJsonObject jsonObject;
+        jsonObject["tag"] = "face";
+        jsonObject["mode"] = "check";
+        jsonObject["usernum"] = m_apiclient->getUsernum();
+        jsonObject["stream"] = streamId;
+        jsonObject["end"] = true;
+        m_apiclient->sendJsonRequest(jsonObject);
+    }
 }
 
 void FaceDetection::recvFace(const QJsonObject& recvJson)
@@ -153,6 +228,14 @@ void FaceDetection::recvFace(const QJsonObject& recvJson)
     if (recvJson["tag"] != "face")
         return;
 
+    // 流式验证的回复，只处理本次验证的；收到结果后停止发送
+    if (recvJson.contains("stream"))
+    {
+        if (recvJson["stream"].toVariant().toLongLong() != streamId)
+            return;
+        stopStream(false);
+    }
+
     if (recvJson["mode"] == "save")
     {
         if (recvJson["result"] == "success")
@@ -220,6 +303,7 @@ void FaceDetection::recvFace(const QJsonObject& recvJson)
 
 void FaceDetection::closeEvent(QCloseEvent* event)
 {
+    stopStream(true);
     if (camera && camera->isActive())
     {
         camera->stop();
@@ -264,7 +348,14 @@ void FaceDetection::on_pu_action_clicked()
         }
     }
 
-    sendFace(currentFrame);
     // 先关闭发送，避免用户多次发送
     ui->pu_action->setEnabled(false);
+
+    // 验证时连续上传多帧，任一帧通过即成功，不必每次失败都重新点击
+    if (m_mode == "check")
+    {
+        startStream();
+        return;
+    }
+    sendFace(currentFrame);
 }
@@ -2,12 +2,14 @@
 #define FACEDETECTION_H
 
 #include <QCamera>
+#include <QElapsedTimer>
 #include <QMediaCaptureSession>
 #include <QMediaDevices>
 #include <QMediaPlayer>
 #include <QVideoSink>
 #include <QWidget>
 
+#include "custom_controls/facecropper.h"
 #include "network_modules/apiclient.h"
 #include "qtimer.h"
 
@@ -37,6 +39,10 @@ private slots:
     void sendFace(const QImage image);
     void recvFace(const QJsonObject& recvJson);
 
+    void startStream();     // 流式验证：按固定帧率连续上传，直到服务器回复结果
+    void sendStreamFrame(); // 流式验证定时器回调
+    void stopStream(bool sendEnd);
+
     void on_pu_action_clicked();
 
 signals:
@@ -55,7 +61,17 @@ private:
     QTimer* timer;                        // 定时器，用于获取一帧摄像头图像
     QMediaPlayer* mediaPlayer;            // 媒体播放器，用于处理音频等内容
 
-    QImage currentFrame; // 存储当前帧的 QImage 对象
+    QImage currentFrame;     // 存储当前帧的 QImage 对象
+    FaceCropper faceCropper; // 本地人脸检测与裁剪
+
+    QTimer* streamTimer;       // 流式验证的发送定时器
+    QElapsedTimer streamClock; // 本次流式验证已持续的时间
+    qint64 streamId = 0;       // 本次流式验证的编号，用于丢弃过期的回复
+    bool streaming = false;
+
+    static constexpr int STREAM_INTERVAL_MS = 200;  // 每秒最多 5 帧
+    static constexpr int STREAM_DURATION_MS = 5000; // 超过后通知服务器结束
+    static constexpr int STREAM_WIDTH = 320;        // 本地未裁剪时上传的画面宽度
 };
 
 #endif // FACEDETECTION_H
@@ -4,10 +4,10 @@
 
 #include "ui_home.h"
 
-Home::Home(const QJsonObject& userInfo, QWidget* parent)
+Home::Home(const QJsonObject& userInfo, const QByteArray& avatarData, QWidget* parent)
     : QWidget(parent)
     , ui(new Ui::Home)
-    , m_user_info(UserInfo::formJson(userInfo))
+    , m_user_info(UserInfo::formJson(userInfo, avatarData))
     , settings("settings.ini", QSettings::IniFormat)
     , m_apiclient(new ApiClient(m_user_info.usernum, this))
 {
@@ -33,17 +33,14 @@ struct UserInfo
     QString role;
     QPixmap m_avatar;
 
-    static UserInfo formJson(const QJsonObject& obj)
+    static UserInfo formJson(const QJsonObject& obj, const QByteArray& avatarData)
     {
         UserInfo info;
         info.usernum = obj["usernum"].toString();
         info.nickname = obj["nickname"].toString();
         info.role = obj["role"].toString();
 
-        QByteArray base64Data = obj["avatar_data"].toString().toUtf8();
-        QByteArray imageData = QByteArray::fromBase64(base64Data);
-
-        if (!info.m_avatar.loadFromData(imageData, "PNG"))
+        if (!info.m_avatar.loadFromData(avatarData, "PNG"))
         {
             qDebug() << "Error: failed to load image from data";
         }
@@ -66,7 +63,7 @@ class Home : public QWidget
     };
 
 public:
-    explicit Home(const QJsonObject& userInfo, QWidget* parent = nullptr);
+    explicit Home(const QJsonObject& userInfo, const QByteArray& avatarData, QWidget* parent = nullptr);
     ~Home();
 
     void setTime();
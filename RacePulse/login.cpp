@@ -284,15 +284,21 @@ void Login::sendLogin()
     m_apiclient->sendJsonRequest(jsonObj);
 }
 
-void Login::recvLogin(const QJsonObject& recvJson)
+void Login::recvLogin(const QJsonObject& recvJson, const Attachments& attachments)
 {
     if (recvJson["tag"] != "login")
         return;
     if (recvJson["result"] == "success")
     {
         saveSettings();
+        // 头像为二进制附件，服务端使用 v1 时回退为 Base64 字段
+        QByteArray avatarData = attachments.value("avatar_data");
+        if (avatarData.isEmpty())
+        {
+            avatarData = QByteArray::fromBase64(recvJson["avatar_data"].toString().toLatin1());
+        }
         // 登录成功 发送信号给主函数
-        emit sigloginSucceed(recvJson);
+        emit sigloginSucceed(recvJson, avatarData);
         m_apiclient->disconnect();
         this->close();
     }
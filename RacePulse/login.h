@@ -48,7 +48,7 @@ public:
     void mousePressEvent(QMouseEvent* event);
 
     void sendLogin();
-    void recvLogin(const QJsonObject& recvJson);
+    void recvLogin(const QJsonObject& recvJson, const Attachments& attachments);
 
     void cleanupConnections();
 
@@ -56,7 +56,7 @@ public:
     QString xorEncryptDecrypt(const QString& data, const QString& key = "xorEncryptDecrypt_key");
 
 signals:
-    void sigloginSucceed(const QJsonObject& qjson);
+    void sigloginSucceed(const QJsonObject& qjson, const QByteArray& avatarData);
     void sigloginFailed();
 
 private slots:
@@ -17,11 +17,11 @@ int main(int argc, char* argv[])
 #if 1
     Login w;
     QPointer<Home> home = nullptr;
-    Home::connect(&w, &Login::sigloginSucceed, [&](const QJsonObject& userInfo)
+    Home::connect(&w, &Login::sigloginSucceed, [&](const QJsonObject& userInfo, const QByteArray& avatarData)
                   {
                       if (!home)
                       {
-                          home = new Home(userInfo);
+                          home = new Home(userInfo, avatarData);
                           home->show();
                       } });
 #else
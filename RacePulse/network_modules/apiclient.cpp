@@ -12,17 +12,8 @@ ApiClient::ApiClient(QString usernum, QObject* parent)
     initSocket();
 
     // 初始化心跳定时器
-    connect(heartbeatTimer, &QTimer::timeout, this, [this]()
-            {
-        if (++missedHeartbeats >= MAX_MISSED_HEARTBEATS) {
-            qDebug() << "Heart beat timeout, reconnecting...";
-            reconnect();
-        } else {
-            // 发送心跳包
-            QJsonObject heartbeat;
-            heartbeat["tag"] = "heartbeat";
-            sendJsonRequest(heartbeat);
-        } });
+    heartbeatTimer->setSingleShot(true);
+    connect(heartbeatTimer, &QTimer::timeout, this, &ApiClient::onHeartbeatTimeout);
 }
 
 ApiClient::~ApiClient()
@@ -48,6 +39,30 @@ ApiClient::~ApiClient()
     }
 }
 
+void ApiClient::onHeartbeatTimeout()
+{
+    // 期间有收发数据，链路在用，按最近活动时间重新计时，不发心跳
+    const qint64 idle = lastActivity.elapsed();
+    if (idle < HEARTBEAT_INTERVAL)
+    {
+        heartbeatTimer->start(int(HEARTBEAT_INTERVAL - idle));
+        return;
+    }
+
+    if (++missedHeartbeats >= MAX_MISSED_HEARTBEATS)
+    {
+        qDebug() << "Heart beat timeout, reconnecting...";
+        reconnect();
+        return;
+    }
+
+    // 链路静默满一个周期，发送心跳包探测
+    QJsonObject heartbeat;
+    heartbeat["tag"] = "heartbeat";
+    sendJsonRequest(heartbeat);
+    heartbeatTimer->start(HEARTBEAT_INTERVAL);
+}
+
 void ApiClient::initSocket()
 {
     if (m_socket)
@@ -86,6 +101,7 @@ bool ApiClient::connectToServer(const QString& host, quint16 port)
 
     if (connected)
     {
+        lastActivity.start();
         heartbeatTimer->start(HEARTBEAT_INTERVAL);
         qDebug() << "Connected to server successfully";
     }
@@ -116,7 +132,7 @@ void ApiClient::disconnect()
 
     // 清空消息队列和缓冲区
     messageQueue.clear();
-    buffer.clear();
+    decoder.clear();
     isSending = false;
 
     if (m_socket)
@@ -183,14 +199,25 @@ void ApiClient::onStateChanged(QAbstractSocket::SocketState socketState)
 void ApiClient::clearBuffers()
 {
     QMutexLocker locker(&socketMutex);
-    buffer.clear();
+    decoder.clear();
     messageQueue.clear();
     isSending = false;
+    peerOptions = CodecOptions();
 }
 
 void ApiClient::onConnected()
 {
     missedHeartbeats = 0;
+
+    // 协商协议版本，服务端应答前仍使用 v1
+    peerOptions = CodecOptions();
+    QJsonObject hello;
+    hello["tag"] = "hello";
+    hello["protocol"] = PROTOCOL_LATEST;
+    hello["encodings"] = FrameCodec::offeredEncodings();
+    hello["compressions"] = FrameCodec::offeredCompressions();
+    sendJsonRequest(hello);
+
     emit connected();
 }
 
@@ -201,13 +228,14 @@ void ApiClient::onDisconnected()
     emit disconnected();
 }
 
-void ApiClient::sendJsonRequest(const QJsonObject& responseJson)
+void ApiClient::sendJsonRequest(const QJsonObject& responseJson, const Attachments& attachments)
 {
     QMutexLocker locker(&socketMutex);
 
-    // 将消息转换为 JSON 格式并添加到消息队列
-    QByteArray jsonData = QJsonDocument(responseJson).toJson() + "END";
+    // 编码为帧并添加到消息队列，附件在 v2 下以二进制段发送
+    QByteArray jsonData = FrameCodec::encode(responseJson, peerOptions, attachments);
     messageQueue.enqueue(jsonData);
+    lastActivity.start();
 
     // 处理消息队列
     processMessageQueue();
@@ -252,54 +280,66 @@ QString ApiClient::getUsernum() const
 
 void ApiClient::onReadyRead()
 {
-    // 从套接字读取所有可用数据并追加到缓存区
-    buffer += m_socket->readAll();
+    // 从套接字读取所有可用数据并追加到解码器
+    decoder.append(m_socket->readAll());
 
-    // 检查缓存区中是否包含完整的消息（以 "END" 为分隔符）
-    while (true)
+    // 依次取出完整的消息（v1 以 "END" 为分隔符，v2 按帧头长度）
+    Frame frame;
+    while (decoder.nextFrame(frame))
     {
-        int endIndex = buffer.indexOf("\n}\nEND");
-        if (endIndex == -1)
-        {
-            break; // 未找到完整消息，等待更多数据
-        }
-
-        // 提取完整消息
-        QByteArray completeMessage = buffer.left(endIndex + 3);
-        buffer.remove(0, endIndex + 6); // 移除已处理的消息
-
-        if (completeMessage.size() > 500)
-            qDebug() << "Received data (size):" << completeMessage.size();
+        if (frame.payload.size() > 500)
+            qDebug() << "Received data (size):" << frame.payload.size();
         else
-            qDebug() << "Received data (content):" << completeMessage;
+            qDebug() << "Received data (content):" << frame.payload;
         // 尝试解析 JSON 数据
-        QJsonDocument jsonDoc = QJsonDocument::fromJson(completeMessage);
-        if (!jsonDoc.isNull() && jsonDoc.isObject())
+        // 任何入站数据都说明连接存活
+        missedHeartbeats = 0;
+        lastActivity.start();
+
+        Message message;
+        if (FrameCodec::decode(frame, message))
         {
-            QJsonObject jsonObj = jsonDoc.object();
+            // 附件以二进制随信号交给界面模块，不再转为 Base64；v1 消息的图片仍是 JSON 中的 Base64 字段
+            QJsonObject& jsonObj = message.json;
+
             if (jsonObj["tag"] == "heartbeat")
             {
                 // 心跳更新
                 missedHeartbeats = 0;
             }
+            else if (jsonObj["tag"] == "hello")
+            {
+                // 服务端确认的协议版本，之后的请求按该版本编码
+                peerOptions.version = qBound(PROTOCOL_V1, jsonObj["protocol"].toInt(PROTOCOL_V1), PROTOCOL_LATEST);
+                peerOptions.encoding = FrameCodec::encodingFromName(jsonObj["encoding"].toString());
+                peerOptions.compression = FrameCodec::compressionFromName(jsonObj["compression"].toString());
+                peerOptions.compressThreshold = FrameCodec::compressThreshold();
+            }
             else if (jsonObj["tag"] == "shutdown")
             {
                 if (m_usernum != nullptr)
                 {
                     jsonObj["tag"] = "home";
                     jsonObj["mode"] = "shutdown";
-                    emit dataReceived(jsonObj);
+                    emit dataReceived(jsonObj, Attachments());
                 }
             }
             else
             {
                 // 其它模块
-                emit dataReceived(jsonObj); // 发送信号处理数据
+                emit dataReceived(jsonObj, message.attachments); // 发送信号处理数据
             }
         }
         else
         {
-            qCritical() << "Invalid JSON message received:" << completeMessage;
+            qCritical() << "Invalid JSON message received:" << frame.payload;
         }
     }
+
+    // 帧头无法识别，无法再对齐后续数据，重新建立连接
+    if (decoder.isCorrupted())
+    {
+        qCritical() << "Corrupted frame received, reconnecting...";
+        reconnect();
+    }
 }
@@ -3,10 +3,12 @@
 
 #include <qqueue.h>
 
+#include <QElapsedTimer>
 #include <QMutex>
 #include <QObject>
 #include <QTcpSocket>
 
+#include "framecodec.h"
 #include "qjsonobject.h"
 #include "qtimer.h"
 
@@ -19,7 +21,7 @@ public:
     ~ApiClient();
 
     bool connectToServer(const QString& host = "127.0.0.1", quint16 port = 10086);
-    void sendJsonRequest(const QJsonObject& responseJson);
+    void sendJsonRequest(const QJsonObject& responseJson, const Attachments& attachments = Attachments());
     QString getUsernum() const; // 添加 const 修饰符
 
     // 添加新的公共方法
@@ -30,7 +32,8 @@ public:
 signals:
     void connected();
     void disconnected();
-    void dataReceived(const QJsonObject& data);
+    // 附件直接引用帧负载，只在槽函数执行期间有效，需要保留时自行拷贝
+    void dataReceived(const QJsonObject& data, const Attachments& attachments);
     void connectionError(const QString& errorMessage);
 
 private slots:
@@ -41,6 +44,7 @@ private slots:
     void onStateChanged(QAbstractSocket::SocketState socketState);
 
 private:
+    void onHeartbeatTimeout();
     void processMessageQueue();
     void initSocket();
     void clearBuffers();
@@ -48,10 +52,11 @@ private:
     // 成员变量
     QTcpSocket* m_socket;
     QString m_usernum;
-    QByteArray buffer;
+    FrameDecoder decoder;
     QQueue<QByteArray> messageQueue;
     QMutex socketMutex;
     bool isSending{false};
+    CodecOptions peerOptions; // 与服务端协商后的协议版本、负载编码与压缩
 
     // 连接相关配置
     QString m_host;
@@ -60,8 +65,9 @@ private:
     static constexpr int CONNECT_TIMEOUT = 1000;             // 连接超时时间(ms)
     static constexpr int MAX_BUFFER_SIZE = 10 * 1024 * 1024; // 最大缓冲区大小(10MB)
 
-    // 心跳检测
+    // 心跳检测，只有收发都静默满一个周期才发送心跳
     QTimer* heartbeatTimer;
+    QElapsedTimer lastActivity; // 最近一次收发数据的时间
     int missedHeartbeats{0};
     static constexpr int MAX_MISSED_HEARTBEATS = 3;
     static constexpr int HEARTBEAT_INTERVAL = 5000;
@@ -83,14 +83,15 @@ void Register::sendRegister()
     QBuffer buffer(&byteArray);
     buffer.open(QIODevice::WriteOnly);
     m_avatar.save(&buffer, "PNG");
-    QString base64Image = byteArray.toBase64();
 
     QJsonObject jsonObj;
     jsonObj["tag"] = "register";
     jsonObj["nickname"] = ui->linee_nickname->text();
     jsonObj["password"] = encryptPassword(ui->linee_password->text());
-    jsonObj["avatar_data"] = base64Image;
-    m_apiclient->sendJsonRequest(jsonObj);
+
+    Attachments attachments;
+    attachments.insert("avatar_data", byteArray);
+    m_apiclient->sendJsonRequest(jsonObj, attachments);
 }
 
 void Register::recvRegister(const QJsonObject& recvJson)
@@ -15,16 +15,74 @@ LIBS += -LD:/Lib/OpenCV-MinGW-Build-OpenCV-4.5.5-x64/x64/mingw/lib
 LIBS += -lopencv_core455 -lopencv_imgproc455 -lopencv_imgcodecs455 -lopencv_highgui455 -lopencv_objdetect455 -lopencv_dnn455
 
 
+# 可选的 ONNX Runtime 推理后端：qmake "CONFIG+=onnxruntime"，配置 face/backend=onnxruntime 启用
+onnxruntime {
+    DEFINES += RACEPULSE_WITH_ONNXRUNTIME
+    INCLUDEPATH += D:/Lib/onnxruntime-win-x64-1.16.3/include
+    LIBS += -LD:/Lib/onnxruntime-win-x64-1.16.3/lib -lonnxruntime
+}
+
+
+# 共用协议模块
+include(../common/common.pri)
+
 SOURCES += \
     clienthandler.cpp \
+    codecbenchmark.cpp \
+    connectionbenchmark.cpp \
     connectionpool.cpp \
+    contestpreloader.cpp \
+    embeddingbackend.cpp \
+    embeddingbenchmark.cpp \
+    facedetector.cpp \
+    faceembeddingstore.cpp \
+    faceindex.cpp \
+    faceinferencepool.cpp \
+    facemetrics.cpp \
+    facemodelregistry.cpp \
+    facepipelinebenchmark.cpp \
+    facequality.cpp \
+    facesimilarity.cpp \
+    framebenchmark.cpp \
+    indexbenchmark.cpp \
+    mailboxbenchmark.cpp \
     main.cpp \
-    server.cpp
+    modelbenchmark.cpp \
+    reactorpool.cpp \
+    server.cpp \
+    sessionbenchmark.cpp \
+    sessionregistry.cpp \
+    similaritybenchmark.cpp \
+    timingwheel.cpp
 
 HEADERS += \
     clienthandler.h \
+    codecbenchmark.h \
+    connectionbenchmark.h \
     connectionpool.h \
-    server.h
+    contestpreloader.h \
+    embeddingbackend.h \
+    embeddingbenchmark.h \
+    facedetector.h \
+    faceembeddingstore.h \
+    faceindex.h \
+    faceinferencepool.h \
+    facemetrics.h \
+    facemodelregistry.h \
+    facepipelinebenchmark.h \
+    facequality.h \
+    facesimilarity.h \
+    framebenchmark.h \
+    indexbenchmark.h \
+    mailbox.h \
+    mailboxbenchmark.h \
+    modelbenchmark.h \
+    reactorpool.h \
+    server.h \
+    sessionbenchmark.h \
+    sessionregistry.h \
+    similaritybenchmark.h \
+    timingwheel.h
 
 FORMS += \
     server.ui
@@ -1,12 +1,21 @@
 #include "clienthandler.h"
 
 #include <qbuffer.h>
-#include <qmessagebox.h>
 
+#include <QElapsedTimer>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
-
+#include <QThread>
+
+#include "facedetector.h"
+#include "faceembeddingstore.h"
+#include "faceindex.h"
+#include "faceinferencepool.h"
+#include "facemetrics.h"
+#include "facemodelregistry.h"
+#include "facequality.h"
+#include "facesimilarity.h"
 #include "qsqlquery.h"
 #include "server.h"
 
@@ -21,28 +30,10 @@ ClientHandler::ClientHandler(QTcpSocket* socket, ConnectionPool& pool, Server* s
     // 设置socket父对象，确保正确的资源管理
     m_socket->setParent(this);
 
-    // 加载 Haar 分类器
-    if (!faceCascade.load("D:/Lib/OpenCV-MinGW-Build-OpenCV-4.5.5-x64/etc/haarcascades/haarcascade_frontalface_default.xml"))
-    {
-        QMessageBox::critical(nullptr, "Error", "Failed to load Haar Cascade.");
-        return;
-    }
+    // 人脸模型由 FaceModelRegistry 在启动时统一加载，连接不再各自加载
 
-    // 初始化心跳定时器
-    heartbeatTimer = new QTimer(this);
-    connect(heartbeatTimer, &QTimer::timeout, this, [this]()
-            {
-        if (++missedHeartbeats >= MAX_MISSED_HEARTBEATS) {
-            qDebug() << "Client" << account << "heart beat timeout, disconnecting...";
-            m_socket->disconnectFromHost();
-        } else {
-            // 发送心跳包
-            QJsonObject heartbeat;
-            heartbeat["tag"] = "heartbeat";
-            sendJsonResponse(heartbeat);
-        } });
-
-    heartbeatTimer->start(HEARTBEAT_INTERVAL);
+    // 由 bytesWritten 驱动发送队列，不再阻塞等待写完
+    connect(m_socket, &QTcpSocket::bytesWritten, this, &ClientHandler::onBytesWritten);
 
     connect(this, &ClientHandler::dataReceived, this, &ClientHandler::processRequest);
 
@@ -51,6 +42,15 @@ ClientHandler::ClientHandler(QTcpSocket* socket, ConnectionPool& pool, Server* s
 
 ClientHandler::~ClientHandler()
 {
+    if (wheel && heartbeatTimerId)
+    {
+        wheel->cancel(heartbeatTimerId);
+    }
+    // 连接已断开，流式验证中排队的帧不再推理
+    if (faceStream.cancelled)
+    {
+        faceStream.cancelled->store(true, std::memory_order_release);
+    }
     m_socket = nullptr;
     if (db.isOpen())
     {
@@ -74,6 +74,48 @@ bool ClientHandler::databasesConnect()
     return true;
 }
 
+void ClientHandler::attachTimingWheel(TimingWheel* timingWheel)
+{
+    // 在反应器线程中调用，心跳定时项挂到该线程的时间轮上
+    wheel = timingWheel;
+    lastActivity = wheel->now();
+    heartbeatTimerId = wheel->schedule(HEARTBEAT_INTERVAL, [this]()
+                                       { onHeartbeatTimeout(); });
+}
+
+void ClientHandler::onHeartbeatTimeout()
+{
+    heartbeatTimerId = 0;
+    if (!m_socket || !wheel)
+    {
+        return;
+    }
+
+    // 期间收到过数据，说明连接存活，按最近活动时间重新计时，不发心跳
+    const qint64 idle = wheel->now() - lastActivity;
+    if (idle < HEARTBEAT_INTERVAL)
+    {
+        heartbeatTimerId = wheel->schedule(HEARTBEAT_INTERVAL - idle, [this]()
+                                           { onHeartbeatTimeout(); });
+        return;
+    }
+
+    if (++missedHeartbeats >= MAX_MISSED_HEARTBEATS)
+    {
+        qDebug() << "Client" << account << "heart beat timeout, disconnecting...";
+        m_socket->disconnectFromHost();
+        return;
+    }
+
+    // 连接静默，发送心跳包探测
+    QJsonObject heartbeat;
+    heartbeat["tag"] = "heartbeat";
+    sendJsonResponse(heartbeat);
+
+    heartbeatTimerId = wheel->schedule(HEARTBEAT_INTERVAL, [this]()
+                                       { onHeartbeatTimeout(); });
+}
+
 void ClientHandler::handleSocketError(QAbstractSocket::SocketError error)
 {
     QString errorMessage = m_socket->errorString();
@@ -101,41 +143,46 @@ void ClientHandler::handleSocketError(QAbstractSocket::SocketError error)
 
 void ClientHandler::onReadyRead()
 {
-    // 从套接字中读取所有可用数据并追加到缓存区
-    buffer += m_socket->readAll();
-
-    while (true)
+    // 发送积压过多时先不处理新请求，数据留在 socket 中，等发送队列回落到低水位
+    if (readPaused || !m_socket)
     {
-        int endIndex = buffer.indexOf("\n}\nEND"); // 6byte 只搜END可能错误截断，不过这种搜索方式还是不安全
-        if (endIndex == -1)
-        {
-            break; // 未找到完整消息，等待更多数据
-        }
-
-        // 打印接收到的数据长度
-        if (buffer.size() > 500)
-            qDebug() << m_socket->socketDescriptor() << ">   Received data (size):" << buffer.size();
-        else
-            qDebug() << m_socket->socketDescriptor() << ">   Received data (content):" << buffer;
+        return;
+    }
 
-        // 提取完整消息
-        QByteArray completeMessage = buffer.left(endIndex + 3);
-        buffer.remove(0, endIndex + 6); // 移除已处理的消息
+    // 从套接字中读取所有可用数据并追加到解码器
+    decoder.append(m_socket->readAll());
 
+    Frame frame;
+    while (m_socket && !readPaused && decoder.nextFrame(frame))
+    {
         // 解析 JSON 数据
         try
         {
-            QJsonDocument jsonDoc = QJsonDocument::fromJson(completeMessage);
-            if (!jsonDoc.isNull() && jsonDoc.isObject())
+            // 任何入站数据都视为存活
+            missedHeartbeats = 0;
+            if (wheel)
+            {
+                lastActivity = wheel->now();
+            }
+
+            Message message;
+            if (FrameCodec::decode(frame, message))
             {
-                QJsonObject jsonObj = jsonDoc.object();
-                if (jsonObj["tag"] == "heartbeat")
+                if (message.json["tag"] == "heartbeat")
                 {
-                    missedHeartbeats = 0;
+                    // 客户端静默满一个周期才发心跳；这段时间内已发过数据时客户端很快会收到，不必回应
+                    if (!wheel || wheel->now() - lastSent >= HEARTBEAT_INTERVAL)
+                    {
+                        sendJsonResponse(message.json);
+                    }
+                }
+                else if (message.json["tag"] == "hello")
+                {
+                    dealHello(message.json);
                 }
                 else
                 {
-                    emit dataReceived(jsonObj); // 发出信号以处理数据
+                    emit dataReceived(message); // 发出信号以处理数据
                 }
             }
             else
@@ -149,6 +196,14 @@ void ClientHandler::onReadyRead()
         }
     }
 
+    // 帧头无法识别，后续数据无法再对齐，只能断开
+    if (m_socket && decoder.isCorrupted())
+    {
+        qWarning() << "Corrupted frame from client" << account << ", disconnecting...";
+        m_socket->abort();
+        return;
+    }
+
     // 如果缓存区中仍有数据但未处理，等待下一次读取
 }
 
@@ -156,10 +211,16 @@ void ClientHandler::onDisconnected()
 {
     qDebug() << "客户端断开连接";
 
+    if (wheel && heartbeatTimerId)
+    {
+        wheel->cancel(heartbeatTimerId);
+        heartbeatTimerId = 0;
+    }
+
     // 如果账户不是默认值，执行移除客户端操作
     if (account != "0" && !account.isEmpty())
     {
-        srv->removeClient(account);
+        srv->removeClient(account, this);
     }
 
     // 关闭数据库连接
@@ -174,22 +235,33 @@ void ClientHandler::onDisconnected()
 
 void ClientHandler::closeConnection()
 {
-    if (m_socket->state() == QAbstractSocket::ConnectedState)
+    if (m_socket && m_socket->state() == QAbstractSocket::ConnectedState)
     {
-        m_socket->disconnectFromHost();
-        if (m_socket->state() == QAbstractSocket::UnconnectedState)
+        // 尚未合并写出的消息先交给 socket，disconnectFromHost 会等缓冲写完再断开
+        while (!messageQueue.isEmpty())
+        {
+            m_socket->write(messageQueue.dequeue());
+        }
+        queuedBytes = 0;
+
+        // 缓冲为空时 disconnected 会同步触发，onDisconnected 会把 m_socket 置空
+        QTcpSocket* socket = m_socket;
+        socket->disconnectFromHost();
+        if (socket->state() == QAbstractSocket::UnconnectedState)
         {
             m_socket = nullptr;
         }
     }
 }
 
-void ClientHandler::processRequest(const QJsonObject& jsonObj)
+void ClientHandler::processRequest(const Message& message)
 {
     // 确保数据库连接
     if (!databasesConnect())
         return;
 
+    const QJsonObject& jsonObj = message.json;
+
     QString tag = jsonObj["tag"].toString();
 
     if (tag == "login")
@@ -198,7 +270,7 @@ void ClientHandler::processRequest(const QJsonObject& jsonObj)
     }
     else if (tag == "register")
     {
-        dealRegister(jsonObj);
+        dealRegister(jsonObj, message.binary("avatar_data"));
     }
     else if (tag == "home")
     {
@@ -209,13 +281,30 @@ void ClientHandler::processRequest(const QJsonObject& jsonObj)
     }
     else if (tag == "face")
     {
-        if (jsonObj["mode"] == "check")
+        // 客户端已检测并裁剪的人脸优先，没有时回退为整帧由服务器检测
+        const QByteArray faceCrop = message.binary("face_crop");
+        const bool preCropped = !faceCrop.isEmpty();
+        const QByteArray imageData = preCropped ? faceCrop : message.binary("face");
+        if (preCropped)
         {
-            dealCheckFace(jsonObj);
+            qDebug() << "客户端裁剪人脸，置信度:" << jsonObj["crop_confidence"].toDouble() << "字节数:" << faceCrop.size();
+        }
+
+        if (jsonObj["mode"] == "check" && jsonObj.contains("stream"))
+        {
+            dealCheckFaceStream(jsonObj, imageData, preCropped);
+        }
+        else if (jsonObj["mode"] == "check")
+        {
+            dealCheckFace(jsonObj, imageData, preCropped);
         }
         else if (jsonObj["mode"] == "save" || jsonObj["mode"] == "modify")
         {
-            dealUpdateFace(jsonObj);
+            dealUpdateFace(jsonObj, imageData, preCropped);
+        }
+        else if (jsonObj["mode"] == "identify")
+        {
+            dealIdentifyFace(jsonObj, imageData, preCropped);
         }
     }
 
@@ -223,67 +312,218 @@ void ClientHandler::processRequest(const QJsonObject& jsonObj)
     pool.releaseConnection(db);
 }
 
+void ClientHandler::dealHello(const QJsonObject& json)
+{
+    // 取双方都支持的最高版本，旧客户端不发送 hello，始终使用 v1
+    const int version = qBound(PROTOCOL_V1, json["protocol"].toInt(PROTOCOL_V1), PROTOCOL_LATEST);
+    CodecOptions options;
+    options.version = version;
+    if (version >= PROTOCOL_V2)
+    {
+        options.encoding = FrameCodec::negotiateEncoding(json["encodings"].toArray());
+        options.compression = FrameCodec::negotiateCompression(json["compressions"].toArray());
+        options.compressThreshold = FrameCodec::compressThreshold();
+    }
+
+    QJsonObject response;
+    response["tag"] = "hello";
+    response["protocol"] = version;
+    response["encoding"] = FrameCodec::encodingName(options.encoding);
+    response["compression"] = FrameCodec::compressionName(options.compression);
+
+    // 应答仍按旧版本编码，入队后再切换
+    sendJsonResponse(response);
+    peerOptions = options;
+
+    qDebug() << "Client protocol negotiated:" << version
+             << FrameCodec::encodingName(options.encoding)
+             << FrameCodec::compressionName(options.compression)
+             << " > " << m_socket->socketDescriptor();
+}
+
+void ClientHandler::post(const QJsonObject& message)
+{
+    mailbox.push(message);
+
+    // 只有第一条未处理的消息负责调度，连续投递合并为一次处理
+    if (!drainScheduled.exchange(true, std::memory_order_acq_rel))
+    {
+        QMetaObject::invokeMethod(this, &ClientHandler::drainMailbox, Qt::QueuedConnection);
+    }
+}
+
+void ClientHandler::drainMailbox()
+{
+    // 先清除标记再取消息，处理期间新投递的消息会重新调度
+    drainScheduled.exchange(false, std::memory_order_acq_rel);
+
+    QJsonObject message;
+    while (mailbox.pop(message))
+    {
+        receiveMessage(message);
+    }
+}
+
 void ClientHandler::receiveMessage(const QJsonObject& json) // 收到别的客户端发送的消息 然后转发
 {
     if (json["tag"] == "duplicate_logins")
     { // 把在线用户挤下线
-        forwordKickedOffline(json);
+        notifyClientShutdown(json);
+        closeConnection();
+    }
+    else if (json["tag"] == "server_shutdown")
+    { // 服务器关闭
+        notifyClientShutdown(json);
+        closeConnection();
+    }
+    else
+    { // 服务器推送，原样转发给客户端
+        sendJsonResponse(json);
     }
 }
 
 void ClientHandler::notifyClientShutdown(const QJsonObject& json)
 {
-    QMutexLocker locker(&socketMutex);
-
-    json["tag"] = "shutdown";
+    QJsonObject notice = json;
+    notice["tag"] = "shutdown";
     if (m_socket && m_socket->isOpen())
     {
-        sendJsonResponse(json);
+        sendJsonResponse(notice);
     }
 }
 
-void ClientHandler::sendJsonResponse(const QJsonObject& responseJson)
+void ClientHandler::sendJsonResponse(const QJsonObject& responseJson, const Attachments& attachments)
 {
-    QMutexLocker locker(&socketMutex);
+    // socket 只能在所属的反应器线程中使用，其它线程发来的消息转交给该线程
+    if (QThread::currentThread() != thread())
+    {
+        QMetaObject::invokeMethod(this, [this, responseJson, attachments]()
+                                  { sendJsonResponse(responseJson, attachments); }, Qt::QueuedConnection);
+        return;
+    }
 
-    // 将消息转换为 JSON 格式并添加到消息队列
-    QByteArray jsonData = QJsonDocument(responseJson).toJson() + "END";
-    messageQueue.enqueue(jsonData);
+    // 编码为帧并添加到消息队列，附件在 v2 下以二进制段发送
+    enqueueFrame(FrameCodec::encode(responseJson, peerOptions, attachments));
+}
 
-    // 处理消息队列
-    processMessageQueue();
+void ClientHandler::enqueueFrame(const QByteArray& frame)
+{
+    if (!m_socket)
+    {
+        return;
+    }
+
+    messageQueue.enqueue(frame);
+    queuedBytes += frame.size();
+    if (wheel)
+    {
+        lastSent = wheel->now();
+    }
+
+    // 客户端接收过慢，积压超过上限
+    const qint64 pending = pendingOutboundBytes();
+    if (pending > maxOutboundBytes)
+    {
+        qWarning() << "Slow consumer" << account << "pending bytes:" << pending;
+        emit slowConsumer(account, pending);
+
+        messageQueue.clear();
+        queuedBytes = 0;
+        if (slowConsumerPolicy == SlowConsumerPolicy::Disconnect)
+        {
+            m_socket->abort();
+        }
+        return;
+    }
+
+    if (pending > highWatermark)
+    {
+        readPaused = true;
+    }
+
+    // 推迟到本轮事件循环结束再写，期间入队的消息合并为一次写入
+    if (!flushScheduled)
+    {
+        flushScheduled = true;
+        QMetaObject::invokeMethod(this, &ClientHandler::processMessageQueue, Qt::QueuedConnection);
+    }
 }
 
 void ClientHandler::processMessageQueue()
 {
-    // 确保队列中有消息且当前未发送中
-    if (messageQueue.isEmpty() || isSending)
+    flushScheduled = false;
+
+    // 确保队列中有消息且 socket 可用
+    if (!m_socket || messageQueue.isEmpty())
     {
         return;
     }
 
-    // 标记当前正在发送
-    isSending = true;
+    // socket 缓冲中未发出的数据超过高水位，等 bytesWritten 回落后再继续
+    if (m_socket->bytesToWrite() >= highWatermark)
+    {
+        return;
+    }
 
-    // 从队列中取出消息
-    QByteArray message = messageQueue.dequeue();
+    // 合并队列中的消息，单次写入不超过高水位
+    QByteArray batch;
+    if (messageQueue.size() == 1)
+    {
+        batch = messageQueue.dequeue();
+    }
+    else
+    {
+        batch.reserve(qMin(queuedBytes, highWatermark));
+        while (!messageQueue.isEmpty() && batch.size() < highWatermark)
+        {
+            batch += messageQueue.dequeue();
+        }
+    }
+    queuedBytes -= batch.size();
 
-    // 写入套接字并等待数据写入完成
-    m_socket->write(message);
-    if (!m_socket->waitForBytesWritten())
+    // 写入套接字缓冲，由事件循环异步发出
+    if (m_socket->write(batch) != batch.size())
     {
-        qCritical() << "Failed to write message to socket.";
-        isSending = false;
+        qCritical() << "Failed to write message to socket:" << m_socket->errorString();
         return;
     }
-    if (message.size() > 500)
-        qDebug() << "Message sent successfully:" << message.size() << " > " << m_socket->socketDescriptor();
-    else
-        qDebug() << "Message sent successfully:" << message << " > " << m_socket->socketDescriptor();
+}
+
+void ClientHandler::onBytesWritten(qint64 bytes)
+{
+    Q_UNUSED(bytes);
 
-    // 标记发送完成，继续处理队列中的下一条消息
-    isSending = false;
+    if (!m_socket || m_socket->bytesToWrite() > lowWatermark)
+    {
+        return;
+    }
+
+    // 回落到低水位，继续发送剩余消息
     processMessageQueue();
+
+    // 积压消化后恢复处理请求
+    if (readPaused && pendingOutboundBytes() <= lowWatermark)
+    {
+        readPaused = false;
+        onReadyRead();
+    }
+}
+
+qint64 ClientHandler::pendingOutboundBytes() const
+{
+    return queuedBytes + (m_socket ? m_socket->bytesToWrite() : 0);
+}
+
+void ClientHandler::setWriteWatermarks(qint64 low, qint64 high)
+{
+    lowWatermark = qMax<qint64>(0, low);
+    highWatermark = qMax(lowWatermark, high);
+}
+
+void ClientHandler::setSlowConsumerLimit(qint64 maxBytes, SlowConsumerPolicy policy)
+{
+    maxOutboundBytes = qMax(highWatermark, maxBytes);
+    slowConsumerPolicy = policy;
 }
 
 void ClientHandler::sendErrorResponse(QJsonObject qjsonObj, const QString& reason)
@@ -343,37 +583,45 @@ void ClientHandler::dealLogin(const QJsonObject& json)
         return;
     }
 
-    // 处理重复登录
-    auto existingClient = srv->getClient(usernum);
-    if (existingClient)
+    // 同一连接切换账号登录，移除原账号的会话
+    if (account != "0" && !account.isEmpty() && account != usernum)
+    {
+        srv->removeClient(account, this);
+    }
+    account = usernum;
+    accountRole = qry.value("role").toString();
+
+    // 登记会话，同一账号已在其他连接在线时把原会话挤下线
+    auto existingClient = srv->addClient(usernum, shared_from_this());
+    if (existingClient && existingClient.get() != this)
     {
+        // 原会话可能在其它反应器线程，投递到它的信箱由它自己断开
         QJsonObject kickMsg;
+        kickMsg["tag"] = "duplicate_logins";
         kickMsg["reason"] = "您的账号在其他地方登录，当前会话已断开。";
-        existingClient->notifyClientShutdown(kickMsg);
-        existingClient->closeConnection();
+        existingClient->post(kickMsg);
     }
 
     // 获取用户信息
     const QString nickname = qry.value("nickname").toString();
     const QString avatarFilename = qry.value("avatar").toString();
-    const QString role = qry.value("role").toString();
 
-    // 读取头像数据
-    QString avatarBase64 = loadAvatarAsBase64(avatarFilename);
+    // 读取头像数据，作为附件发送
+    Attachments attachments;
+    attachments.insert("avatar_data", loadAvatarData(avatarFilename));
 
     // 构建成功响应
     response["result"] = "success";
     response["usernum"] = usernum;
     response["nickname"] = nickname;
-    response["role"] = role;
-    response["avatar_data"] = avatarBase64;
+    response["role"] = accountRole;
 
-    sendJsonResponse(response);
+    sendJsonResponse(response, attachments);
     qDebug() << "用户" << usernum << "登录成功";
 }
 
-// 将头像文件转换为Base64
-QString ClientHandler::loadAvatarAsBase64(const QString& avatarFilename)
+// 读取头像文件数据
+QByteArray ClientHandler::loadAvatarData(const QString& avatarFilename)
 {
     // 构建头像文件路径
     QString avatarPath = QString("./avatar/%1").arg(avatarFilename);
@@ -391,10 +639,10 @@ QString ClientHandler::loadAvatarAsBase64(const QString& avatarFilename)
     if (!file.open(QIODevice::ReadOnly))
     {
         qDebug() << "无法打开头像文件:" << avatarPath;
-        return QString();
+        return QByteArray();
     }
 
-    // 读取文件数据并转换为Base64
+    // 读取文件数据
     QByteArray imageData = file.readAll();
     file.close();
 
@@ -403,7 +651,7 @@ QString ClientHandler::loadAvatarAsBase64(const QString& avatarFilename)
     if (!image.loadFromData(imageData))
     {
         qDebug() << "无效的图片数据:" << avatarPath;
-        return QString();
+        return QByteArray();
     }
 
     // 如果图片过大，进行压缩
@@ -416,10 +664,10 @@ QString ClientHandler::loadAvatarAsBase64(const QString& avatarFilename)
         imageData = tp_buffer.data();
     }
 
-    return QString(imageData.toBase64());
+    return imageData;
 }
 
-void ClientHandler::dealRegister(const QJsonObject& json)
+void ClientHandler::dealRegister(const QJsonObject& json, const QByteArray& avatarData)
 {
     QMutexLocker locker(&dbMutex);
     QJsonObject response;
@@ -468,7 +716,7 @@ void ClientHandler::dealRegister(const QJsonObject& json)
     }
 
     // 处理头像
-    QString avatarPath = handleAvatar(usernum, json);
+    QString avatarPath = handleAvatar(usernum, avatarData);
     if (avatarPath.isEmpty())
     {
         avatarPath = "default.png"; // 使用默认头像
@@ -543,10 +791,10 @@ QString ClientHandler::generateUniqueUsernum()
 }
 
 // 处理头像上传
-QString ClientHandler::handleAvatar(const QString& usernum, const QJsonObject& json)
+QString ClientHandler::handleAvatar(const QString& usernum, const QByteArray& imageData)
 {
     // 检查是否有头像数据
-    if (!json.contains("avatar_data"))
+    if (imageData.isEmpty())
     {
         return QString();
     }
@@ -560,15 +808,6 @@ QString ClientHandler::handleAvatar(const QString& usernum, const QJsonObject& j
 
     QString avatarPath = QString("./avatar/%1.png").arg(usernum);
 
-    // 解码Base64头像数据
-    QByteArray imageData = QByteArray::fromBase64(
-        json["avatar_data"].toString().toUtf8());
-
-    if (imageData.isEmpty())
-    {
-        return QString();
-    }
-
     // 保存头像文件
     QImage image;
     if (!image.loadFromData(imageData))
@@ -787,172 +1026,195 @@ void ClientHandler::dealSearchTerm(const QJsonObject& json)
 }
 void ClientHandler::dealContainsFace(const QJsonObject& json)
 {
-    QMutexLocker locker(&dbMutex);
     QJsonObject qjsonObj;
-    QSqlQuery qry(db);
-
     qjsonObj["tag"] = "home";
     qjsonObj["mode"] = "face_bind";
 
+    // 只查特征库的内存索引，不再打开特征文件
     QString usernum = json["usernum"].toString();
-    QString face_path = nullptr;
-
-    // 通过用户账号查找面部数据地址
-    qry.prepare("SELECT face_path FROM User WHERE usernum =:usernum");
-    qry.bindValue(":usernum", usernum);
-
-    if (qry.exec() && qry.next())
+    if (FaceEmbeddingStore::getInstance().has(usernum))
     {
-        face_path = qry.value("face_path").toString();
-        if (face_path.isEmpty())
-        {
-            qjsonObj["status"] = "no";
-            qjsonObj["reason"] = "账号未上传认证照片";
-        }
-        else
-        {
-            // 打开文件并检查是否存在以 "feature_" 开头的数据
-            cv::FileStorage fs(face_path.toStdString(), cv::FileStorage::READ);
-            if (!fs.isOpened())
-            {
-                qjsonObj["status"] = "no";
-                qjsonObj["reason"] = "无法打开面部数据文件";
-                qDebug() << "Failed to open file:" << face_path;
-            }
-            else
-            {
-                bool containsFeature = false;
-                cv::FileNode rootNode = fs.root();
-                for (cv::FileNodeIterator it = rootNode.begin(); it != rootNode.end(); ++it)
-                {
-                    std::string nodeName = (*it).name();
-                    if (nodeName.find("feature_") == 0) // 检查节点名称是否以 "feature_" 开头
-                    {
-                        containsFeature = true;
-                        break;
-                    }
-                }
-
-                if (containsFeature)
-                {
-                    qjsonObj["status"] = "yes";
-                    qjsonObj["reason"] = "面部数据已绑定";
-                }
-                else
-                {
-                    qjsonObj["status"] = "no";
-                    qjsonObj["reason"] = "面部数据文件为空或格式错误";
-                }
-
-                fs.release(); // 关闭文件
-            }
-        }
+        qjsonObj["status"] = "yes";
+        qjsonObj["reason"] = "面部数据已绑定";
     }
     else
     {
         qjsonObj["status"] = "no";
-        qjsonObj["reason"] = "数据库查询出错";
-        qDebug() << "Query failed:" << qry.lastError().text();
+        qjsonObj["reason"] = "账号未上传认证照片";
     }
 
     // 发送响应
     sendJsonResponse(qjsonObj);
 }
 
-void ClientHandler::dealCheckFace(const QJsonObject& json)
+void ClientHandler::dealCheckFace(const QJsonObject& json, const QByteArray& imageData, bool preCropped)
 {
-    QMutexLocker locker(&dbMutex);
     QJsonObject qjsonObj;
-    QSqlQuery qry(db);
-
     qjsonObj["tag"] = "face";
     qjsonObj["mode"] = "check";
 
     QString usernum = json["usernum"].toString();
-    QString face_path = ""; // 初始化为空字符串
 
-    // 通过用户账号查找面部数据地址
-    qry.prepare("SELECT face_path FROM User WHERE usernum = :usernum");
-    qry.bindValue(":usernum", usernum);
+    // 特征库索引在内存中，未绑定时直接返回，不查数据库
+    if (!FaceEmbeddingStore::getInstance().has(usernum))
+    {
+        sendErrorResponse(qjsonObj, "账号未上传认证照片");
+        return;
+    }
 
-    if (!qry.exec() || !qry.next()) // 查询失败时直接返回
+    // 检测并裁剪人脸，失败原因写入 reason，由调用方回复
+    cv::Mat resizedFace;
+    QString reason;
+    if (!detectFace(imageData, preCropped, resizedFace, reason))
     {
-        sendErrorResponse(qjsonObj, "数据库查询出错");
-        qDebug() << "Query failed:" << qry.lastError().text();
+        sendErrorResponse(qjsonObj, reason);
         return;
     }
 
-    face_path = qry.value("face_path").toString();
+    // 特征提取交给推理线程池，完成后回到本线程比对
+    bool submitted = extractFeatureAsync(resizedFace, [this, qjsonObj, usernum](const cv::Mat& featureVector) mutable
+                                         {
+                                             if (featureVector.empty())
+                                             {
+                                                 sendErrorResponse(qjsonObj, "人脸特征提取失败");
+                                                 return;
+                                             }
+
+                                             if (verifyIdentity(featureVector, usernum))
+                                             {
+                                                 qjsonObj["result"] = "success";
+                                             }
+                                             else
+                                             {
+                                                 qjsonObj["result"] = "fail";
+                                                 qjsonObj["reason"] = "人脸认证未通过";
+                                             }
 
-    if (face_path.isEmpty()) // 如果 face_path 为空，返回错误信息
+                                             sendJsonResponse(qjsonObj); });
+    if (!submitted)
     {
-        sendErrorResponse(qjsonObj, "账号未上传认证照片");
-        return;
+        sendErrorResponse(qjsonObj, "服务器繁忙，请稍后重试");
     }
+}
 
-    // 提取 Base64 字符串并解码为字节数组
-    QByteArray base64Data = json["face"].toString().toUtf8();
-    QByteArray imageData = QByteArray::fromBase64(base64Data);
+void ClientHandler::dealCheckFaceStream(const QJsonObject& json, const QByteArray& imageData, bool preCropped)
+{
+    const qint64 streamId = json["stream"].toVariant().toLongLong();
 
-    // 将字节数组转换为 QImage
-    QImage image;
-    if (!image.loadFromData(imageData, "PNG")) // 假设发送的是 PNG 格式
+    // 新的验证流，取消上一个流中尚未推理的帧
+    if (streamId != faceStream.id)
     {
-        sendErrorResponse(qjsonObj, "Error: Failed to load image from data");
-        return;
+        if (faceStream.cancelled)
+        {
+            faceStream.cancelled->store(true, std::memory_order_release);
+        }
+        faceStream = FaceStream();
+        faceStream.id = streamId;
+        faceStream.usernum = json["usernum"].toString();
+        faceStream.lastReason = "未找到人脸，请正视摄像头";
+        faceStream.cancelled = std::make_shared<std::atomic<bool>>(false);
+
+        // 特征库索引在内存中，未绑定时直接返回，不查数据库
+        if (!FaceEmbeddingStore::getInstance().has(faceStream.usernum))
+        {
+            faceStream.lastReason = "账号未上传认证照片";
+            finishFaceStream(false);
+            return;
+        }
     }
 
-    // 图像处理与人脸验证逻辑
-    cv::Mat matImage = QImageToCvMat(image);
-    if (matImage.empty())
+    // 已回复结果的流，之后到达的帧直接丢弃
+    if (faceStream.finished)
     {
-        sendErrorResponse(qjsonObj, "Error: Failed to convert QImage to cv::Mat");
         return;
     }
 
-    cv::Mat grayImage;
-    cv::cvtColor(matImage, grayImage, cv::COLOR_BGR2GRAY);
-    cv::equalizeHist(grayImage, grayImage);
-
-    std::vector<cv::Rect> faces;
-    faceCascade.detectMultiScale(grayImage, faces, 1.1, 3, 0, cv::Size(30, 30));
-
-    if (faces.empty()) // 如果没有检测到人脸，返回错误信息
+    if (json["end"].toBool() || ++faceStream.frames > STREAM_MAX_FRAMES)
     {
-        sendErrorResponse(qjsonObj, "未找到人脸，请正视摄像头");
+        faceStream.ended = true;
+        if (faceStream.inFlight == 0)
+        {
+            finishFaceStream(false);
+        }
         return;
     }
-    if (faces.size() > 1) // 如果检测到多张人脸，返回错误信息
+
+    // 推理跟不上时丢帧，客户端很快会送来更新的画面
+    if (faceStream.inFlight >= STREAM_MAX_IN_FLIGHT)
     {
-        sendErrorResponse(qjsonObj, "检测到多张人脸，请确保仅有一人");
         return;
     }
 
-    // 提取特征向量并进行身份验证
-    cv::Mat faceROI = matImage(faces[0]);
+    // 检测失败的帧不回复，只记录原因，整个流失败时告诉客户端
     cv::Mat resizedFace;
-    cv::resize(faceROI, resizedFace, cv::Size(112, 112));
-
-    cv::Mat featureVector = extractFeatureVector(resizedFace);
+    QString reason;
+    if (!detectFace(imageData, preCropped, resizedFace, reason))
+    {
+        faceStream.lastReason = reason;
+        return;
+    }
 
-    bool isVerified = verifyIdentity(featureVector, face_path.toStdString());
+    // 本帧推理期间继续检测后续帧，结果回到本线程按流编号核对
+    ++faceStream.inFlight;
+    bool submitted = extractFeatureAsync(resizedFace, [this, streamId](const cv::Mat& featureVector)
+                                         {
+                                             if (faceStream.id != streamId || faceStream.finished)
+                                             {
+                                                 return;
+                                             }
+                                             --faceStream.inFlight;
+
+                                             if (featureVector.empty())
+                                             {
+                                                 faceStream.lastReason = "人脸特征提取失败";
+                                             }
+                                             else if (verifyIdentity(featureVector, faceStream.usernum))
+                                             {
+                                                 finishFaceStream(true);
+                                                 return;
+                                             }
+                                             else
+                                             {
+                                                 faceStream.lastReason = "人脸认证未通过";
+                                             }
+
+                                             if (faceStream.ended && faceStream.inFlight == 0)
+                                             {
+                                                 finishFaceStream(false);
+                                             } },
+                                         faceStream.cancelled);
+    if (!submitted)
+    {
+        --faceStream.inFlight;
+        faceStream.lastReason = "服务器繁忙，请稍后重试";
+    }
+}
 
-    if (isVerified)
+void ClientHandler::finishFaceStream(bool success)
+{
+    faceStream.finished = true;
+    if (faceStream.cancelled)
     {
-        qjsonObj["result"] = "success";
+        faceStream.cancelled->store(true, std::memory_order_release);
     }
-    else
+
+    QJsonObject qjsonObj;
+    qjsonObj["tag"] = "face";
+    qjsonObj["mode"] = "check";
+    qjsonObj["stream"] = faceStream.id;
+    qjsonObj["frames"] = faceStream.frames;
+    if (!success)
     {
-        qjsonObj["result"] = "fail";
-        qjsonObj["reason"] = "人脸认证未通过";
+        sendErrorResponse(qjsonObj, faceStream.lastReason);
+        return;
     }
-
+    qjsonObj["result"] = "success";
     sendJsonResponse(qjsonObj);
 }
 
-void ClientHandler::dealUpdateFace(const QJsonObject& json)
+void ClientHandler::dealUpdateFace(const QJsonObject& json, const QByteArray& imageData, bool preCropped)
 {
-    if (!json.contains("usernum") || !json.contains("face") || json["face"].toString().isEmpty())
+    if (!json.contains("usernum") || imageData.isEmpty())
     {
         sendErrorResponse(QJsonObject(), "Face data is missing or empty.");
         return;
@@ -963,325 +1225,293 @@ void ClientHandler::dealUpdateFace(const QJsonObject& json)
     qjsonObj["mode"] = json["mode"];
 
     QString usernum = json["usernum"].toString();
-    QString relativePath = "./faces/" + usernum + ".yml";
-
-    // 检查 mode 是否为 modify
-    QString mode = json["mode"].toString();
-    if (mode == "modify")
-    {
-        QFile file(relativePath);
-        if (file.exists())
-        {
-            if (!file.remove())
-            {
-                sendErrorResponse(qjsonObj, "Failed to delete existing feature vector file.");
-                return;
-            }
-            qDebug() << "Existing feature vector file deleted for usernum:" << usernum;
-        }
-    }
 
-    // 创建文件夹
-    QDir dir("./faces");
-    if (!dir.exists() && !dir.mkpath("."))
+    // 先检测并裁剪人脸、提取特征，图片不合格时原有特征保持不变
+    cv::Mat resizedFace;
+    QString reason;
+    if (!detectFace(imageData, preCropped, resizedFace, reason))
     {
-        sendErrorResponse(qjsonObj, "Failed to create directory: ./faces");
+        sendErrorResponse(qjsonObj, reason);
         return;
     }
 
-    // 数据库更新
-    {
-        QMutexLocker locker(&dbMutex);
-        db.transaction();
-        QSqlQuery qry(db);
-        qry.prepare("UPDATE User SET face_path = :face_path WHERE usernum = :usernum");
-        qry.bindValue(":face_path", relativePath);
-        qry.bindValue(":usernum", usernum);
-        if (!qry.exec())
-        {
-            db.rollback();
-            sendErrorResponse(qjsonObj, "Failed to update face_path: " + qry.lastError().text());
-            return;
-        }
-        db.commit();
+    // modify 模式用新特征整体替换原有特征，save 模式追加为新模板
+    const bool replace = json["mode"].toString() == "modify";
+    bool submitted = extractFeatureAsync(resizedFace, [this, qjsonObj, usernum, replace](const cv::Mat& featureVector) mutable
+                                         {
+                                             if (featureVector.empty())
+                                             {
+                                                 sendErrorResponse(qjsonObj, "人脸特征提取失败");
+                                                 return;
+                                             }
+
+                                             FaceEmbeddingStore& store = FaceEmbeddingStore::getInstance();
+                                             const bool saved = replace ? store.replace(usernum, featureVector)
+                                                                        : saveFeatureVector(featureVector, usernum);
+                                             if (!saved)
+                                             {
+                                                 sendErrorResponse(qjsonObj, "保存特征向量失败");
+                                                 return;
+                                             }
+
+                                             // 数据库更新
+                                             {
+                                                 QMutexLocker locker(&dbMutex);
+                                                 if (!databasesConnect())
+                                                 {
+                                                     sendErrorResponse(qjsonObj, "数据库连接失败");
+                                                     return;
+                                                 }
+                                                 QSqlQuery qry(db);
+                                                 qry.prepare("UPDATE User SET face_path = :face_path WHERE usernum = :usernum");
+                                                 qry.bindValue(":face_path", store.pathFor(usernum));
+                                                 qry.bindValue(":usernum", usernum);
+                                                 const bool updated = qry.exec();
+                                                 pool.releaseConnection(db);
+                                                 if (!updated)
+                                                 {
+                                                     sendErrorResponse(qjsonObj, "Failed to update face_path: " + qry.lastError().text());
+                                                     return;
+                                                 }
+                                             }
+
+                                             qjsonObj["result"] = "success";
+                                             sendJsonResponse(qjsonObj);
+                                             qDebug() << "Face data updated successfully for usernum:" << usernum; });
+    if (!submitted)
+    {
+        sendErrorResponse(qjsonObj, "服务器繁忙，请稍后重试");
     }
+}
 
-    // 图像解码
-    QByteArray imageData = QByteArray::fromBase64(json["face"].toString().toUtf8());
-    QImage image;
-    if (!image.loadFromData(imageData, "PNG"))
+void ClientHandler::dealIdentifyFace(const QJsonObject& json, const QByteArray& imageData, bool preCropped)
+{
+    Q_UNUSED(json);
+
+    QJsonObject qjsonObj;
+    qjsonObj["tag"] = "face";
+    qjsonObj["mode"] = "identify";
+
+    // 识别结果会暴露用户账号，只对已登录的管理员与裁判（签到终端）开放
+    if (accountRole != "管理员" && accountRole != "裁判")
     {
-        sendErrorResponse(qjsonObj, "Failed to load image from data.");
+        sendErrorResponse(qjsonObj, "无权限使用人脸识别");
         return;
     }
 
-    cv::Mat matImage = QImageToCvMat(image);
-    if (matImage.empty())
+    cv::Mat resizedFace;
+    QString reason;
+    if (!detectFace(imageData, preCropped, resizedFace, reason))
     {
-        sendErrorResponse(qjsonObj, "Failed to convert QImage to cv::Mat.");
+        sendErrorResponse(qjsonObj, reason);
         return;
     }
 
-    // 人脸检测
-    cv::Mat grayImage;
-    cv::cvtColor(matImage, grayImage, cv::COLOR_BGR2GRAY);
-    cv::equalizeHist(grayImage, grayImage);
+    // 1:N 识别，在全部已绑定用户中查找最相近的一个
+    bool submitted = extractFeatureAsync(resizedFace, [this, qjsonObj](const cv::Mat& featureVector) mutable
+                                         {
+                                             if (featureVector.empty())
+                                             {
+                                                 sendErrorResponse(qjsonObj, "人脸特征提取失败");
+                                                 return;
+                                             }
+
+                                             QString usernum;
+                                             float distance = 0.0f;
+                                             if (identifyUser(featureVector, usernum, distance))
+                                             {
+                                                 qjsonObj["result"] = "success";
+                                                 qjsonObj["usernum"] = usernum;
+                                                 qjsonObj["distance"] = distance;
+                                             }
+                                             else
+                                             {
+                                                 qjsonObj["result"] = "fail";
+                                                 qjsonObj["reason"] = "未找到匹配的用户";
+                                             }
+
+                                             sendJsonResponse(qjsonObj); });
+    if (!submitted)
+    {
+        sendErrorResponse(qjsonObj, "服务器繁忙，请稍后重试");
+    }
+}
 
-    std::vector<cv::Rect> faces;
-    faceCascade.detectMultiScale(grayImage, faces, 1.1, 3, 0, cv::Size(30, 30));
+bool ClientHandler::detectFace(const QByteArray& imageData, bool preCropped, cv::Mat& face, QString& reason)
+{
+    // 解码缓冲按线程复用，同尺寸的图片不再重新分配
+    thread_local cv::Mat matImage;
 
-    if (faces.empty())
+    if (imageData.isEmpty())
     {
-        sendErrorResponse(qjsonObj, "未找到人脸，请正视摄像头");
-        return;
+        reason = "Error: Failed to load image from data";
+        return false;
     }
 
-    if (faces.size() > 1)
+    // 直接从附件字节解码为 BGR，支持 PNG 与 JPEG
+    QElapsedTimer decodeTimer;
+    decodeTimer.start();
+    try
     {
-        sendErrorResponse(qjsonObj, "检测到多张人脸，请确保仅有一人");
-        return;
+        const cv::Mat encoded(1, int(imageData.size()), CV_8UC1, const_cast<char*>(imageData.constData()));
+        cv::imdecode(encoded, cv::IMREAD_COLOR, &matImage);
     }
-
-    // 提取和保存特征向量
-    cv::Mat faceROI = matImage(faces[0]);
-    cv::Mat resizedFace;
-    cv::resize(faceROI, resizedFace, cv::Size(112, 112));
-
-    cv::Mat featureVector = extractFeatureVector(resizedFace);
-    if (!saveFeatureVector(featureVector, relativePath.toStdString()))
+    catch (const cv::Exception& e)
     {
-        sendErrorResponse(qjsonObj, "保存特征向量失败");
-        return;
+        qDebug() << "imdecode failed:" << QString::fromStdString(e.what());
+        matImage.release();
     }
+    FaceMetrics::getInstance().record(FaceMetrics::Decode, decodeTimer.nsecsElapsed());
 
-    qjsonObj["result"] = "success";
-    sendJsonResponse(qjsonObj);
-    qDebug() << "Face data updated successfully for usernum:" << usernum;
-}
+    if (matImage.empty())
+    {
+        reason = "Error: Failed to load image from data";
+        return false;
+    }
 
-bool ClientHandler::saveFeatureVector(const cv::Mat& featureVector, const std::string& filename)
-{
-    cv::FileStorage fs(filename, cv::FileStorage::APPEND);
-    if (!fs.isOpened())
+    // 客户端已完成检测和裁剪，跳过服务器端检测，人脸占画面的比例未知
+    if (preCropped)
     {
-        qDebug() << "Failed to open file for saving features: " << QString::fromStdString(filename);
-        return false; // 文件打开失败，返回 false
+        cv::resize(matImage, face, cv::Size(112, 112));
+        return checkFaceQuality(face, -1.0, reason);
     }
 
-    // 生成时间戳
-    auto now = std::chrono::system_clock::now();
-    auto timestamp = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
-    std::string featureName = "feature_" + std::to_string(timestamp);
+    // 在缩小的工作图上检测，人脸框映射回原图
+    QElapsedTimer detectTimer;
+    detectTimer.start();
+    std::vector<FaceDetector::Detection> faces;
+    const bool detectorReady = FaceDetector::detect(matImage, faces);
+    FaceMetrics::getInstance().record(FaceMetrics::Detect, detectTimer.nsecsElapsed());
 
-    // 保存特征向量
-    fs << featureName << featureVector;
+    if (!detectorReady)
+    {
+        reason = "人脸模型未加载";
+        return false;
+    }
 
-    fs.release();
-    qDebug() << "Feature vector saved to: " << QString::fromStdString(filename)
-             << " with name: " << QString::fromStdString(featureName);
+    if (faces.empty()) // 如果没有检测到人脸，返回原因
+    {
+        reason = "未找到人脸，请正视摄像头";
+        return false;
+    }
+    if (faces.size() > 1) // 如果检测到多张人脸，返回原因
+    {
+        reason = "检测到多张人脸，请确保仅有一人";
+        return false;
+    }
 
-    return true; // 成功保存，返回 true
+    // 在原图上裁剪并缩放到特征模型的输入尺寸
+    cv::resize(matImage(faces[0].box), face, cv::Size(112, 112));
+    return checkFaceQuality(face, double(faces[0].box.width) / matImage.cols, reason);
 }
 
-bool ClientHandler::verifyIdentity(const cv::Mat& inputFeature, const std::string& filename)
+bool ClientHandler::checkFaceQuality(const cv::Mat& face, double faceRatio, QString& reason)
 {
-    qDebug() << "Input feature size:" << inputFeature.size().width << " " << inputFeature.size().height
-             << "channels:" << inputFeature.channels()
-             << "type:" << inputFeature.type();
+    // 模糊、曝光不当或过小的人脸不可能通过比对，直接拒绝，省下一次特征提取
+    QElapsedTimer qualityTimer;
+    qualityTimer.start();
+    const FaceQuality::Issue issue = FaceQuality::check(face, faceRatio);
+    FaceMetrics::getInstance().record(FaceMetrics::Quality, qualityTimer.nsecsElapsed());
 
-    cv::FileStorage fs(filename, cv::FileStorage::READ);
-    if (!fs.isOpened())
+    if (issue != FaceQuality::None)
     {
-        qDebug() << "Failed to open file for reading features!";
-        fs.release();
+        FaceMetrics::getInstance().recordRejected(issue);
+        reason = FaceQuality::reason(issue);
         return false;
     }
+    return true;
+}
 
-    // 转换输入特征到float类型
-    cv::Mat normalizedInputFeature;
-    if (inputFeature.type() != CV_32FC1)
+bool ClientHandler::saveFeatureVector(const cv::Mat& featureVector, const QString& usernum)
+{
+    if (!FaceEmbeddingStore::getInstance().append(usernum, featureVector))
     {
-        inputFeature.convertTo(normalizedInputFeature, CV_32FC1);
+        qDebug() << "Failed to save feature vector for usernum:" << usernum;
+        return false;
     }
-    else
+
+    qDebug() << "Feature vector saved for usernum:" << usernum;
+    return true;
+}
+
+bool ClientHandler::verifyIdentity(const cv::Mat& inputFeature, const QString& usernum)
+{
+    std::shared_ptr<const FaceTemplates> templates = FaceEmbeddingStore::getInstance().templates(usernum);
+    if (!templates || templates->count == 0)
     {
-        normalizedInputFeature = inputFeature.clone();
+        qDebug() << "No stored features for usernum:" << usernum;
+        return false;
     }
 
-    // 对输入特征进行L2归一化
+    // 存储的模板已归一化，只需归一化输入特征
+    cv::Mat normalizedInputFeature;
+    inputFeature.reshape(1, 1).convertTo(normalizedInputFeature, CV_32F);
     normalize(normalizedInputFeature, normalizedInputFeature, 1.0, 0.0, cv::NORM_L2);
 
-    std::vector<cv::Mat> storedFeatures;
-    cv::FileNode rootNode = fs.root();
-    float minDistance = std::numeric_limits<float>::max(); // 记录最小距离
-
-    for (cv::FileNodeIterator it = rootNode.begin(); it != rootNode.end(); ++it)
+    if (normalizedInputFeature.cols != templates->dim)
     {
-        std::string featureName = (*it).name();
-        if (featureName.find("feature_") == 0)
-        {
-            cv::Mat storedFeature;
-            (*it) >> storedFeature;
-
-            // 确保存储的特征也是float类型
-            if (storedFeature.type() != CV_32FC1)
-            {
-                storedFeature.convertTo(storedFeature, CV_32FC1);
-            }
-
-            // 对存储的特征进行L2归一化
-            normalize(storedFeature, storedFeature, 1.0, 0.0, cv::NORM_L2);
-
-            qDebug() << "Stored feature" << featureName
-                     << "size:" << storedFeature.size().width << " " << storedFeature.size().height
-                     << "channels:" << storedFeature.channels()
-                     << "type:" << storedFeature.type();
-
-            if (normalizedInputFeature.size() != storedFeature.size() ||
-                normalizedInputFeature.channels() != storedFeature.channels())
-            {
-                qDebug() << "Feature size mismatch!";
-                continue;
-            }
-
-            // 计算余弦相似度（对于L2归一化的向量，可以直接用点积）
-            float similarity = normalizedInputFeature.dot(storedFeature);
-            float distance = 1.0 - similarity; // 转换为距离度量
-
-            qDebug() << "Distance with" << featureName << ":" << distance;
-            minDistance = std::min(minDistance, distance);
-        }
+        qDebug() << "Feature size mismatch!" << normalizedInputFeature.cols << templates->dim;
+        return false;
     }
 
-    fs.release();
-
     // 使用更合理的阈值（对于余弦距离来说，通常0.4-0.6是比较合理的范围）
     const float THRESHOLD = 0.5;
-    qDebug() << "Minimum distance found:" << minDistance;
-
-    return minDistance < THRESHOLD;
-}
+    const float CENTROID_MARGIN = 0.1f; // 质心距离落在阈值附近时才逐个比对模板
 
-cv::Mat ClientHandler::QImageToCvMat(const QImage& Image)
-{
-    QImage image = Image;
-    cv::Mat mat;
-    switch (image.format())
-    {
-    case QImage::Format_ARGB32:
-    case QImage::Format_ARGB32_Premultiplied:
-    case QImage::Format_RGBA8888:
-    case QImage::Format_RGBA8888_Premultiplied: // 添加对这个格式的支持
-        mat = cv::Mat(image.height(), image.width(), CV_8UC4, (void*)image.constBits(), image.bytesPerLine());
-        break;
-    case QImage::Format_RGB32:
-        mat = cv::Mat(image.height(), image.width(), CV_8UC4, (void*)image.constBits(), image.bytesPerLine());
-        break;
-    case QImage::Format_RGB888:
-        mat = cv::Mat(image.height(), image.width(), CV_8UC3, (void*)image.constBits(), image.bytesPerLine());
-        break;
-    default:
-        qDebug() << "Converting unsupported format:" << image.format() << "to Format_RGBA8888";
-        // 强制转换为支持的格式
-        image = image.convertToFormat(QImage::Format_RGBA8888);
-        mat = cv::Mat(image.height(), image.width(), CV_8UC4, (void*)image.constBits(), image.bytesPerLine());
-        break;
-    }
-    // 4通道转3通道
-    if (mat.channels() == 4)
+    // 余弦距离（L2 归一化后即 1 - 点积），先与质心比较，明确通过或明确拒绝时直接返回
+    const float* probe = normalizedInputFeature.ptr<float>();
+    const float centroidDistance = 1.0f - FaceSimilarity::dot(probe, templates->centroid.data(), templates->dim);
+    if (centroidDistance < THRESHOLD - CENTROID_MARGIN || centroidDistance > THRESHOLD + CENTROID_MARGIN)
     {
-        cv::cvtColor(mat, mat, cv::COLOR_BGRA2BGR);
+        qDebug() << "Centroid distance:" << centroidDistance;
+        return centroidDistance < THRESHOLD;
     }
-    return mat;
-}
 
-cv::Mat ClientHandler::extractFeatureVector(const cv::Mat& faceImage)
-{
-    try
-    {
-        // 检查网络是否成功加载
-        static cv::dnn::Net featureNet = cv::dnn::readNetFromONNX("D:\\Personal Data\\Qt\\face_test\\w600k_r50.onnx");
-        if (featureNet.empty())
-        {
-            qDebug() << "Failed to load network model";
-            return cv::Mat();
-        }
+    // 向量化内核一次扫描全部模板
+    const float minDistance = FaceSimilarity::nearest(probe, templates->data.data(), templates->count, templates->dim).distance;
+    qDebug() << "Centroid distance:" << centroidDistance << "Minimum distance found:" << minDistance;
 
-        // 预处理输入图像
-        cv::Mat processedImage;
-        cv::Mat resizedImage;
+    return minDistance < THRESHOLD;
+}
 
-        // 确保输入图像是BGR格式
-        if (faceImage.channels() == 1)
-        {
-            cv::cvtColor(faceImage, processedImage, cv::COLOR_GRAY2BGR);
-        }
-        else
-        {
-            processedImage = faceImage.clone();
-        }
+bool ClientHandler::identifyUser(const cv::Mat& inputFeature, QString& usernum, float& distance)
+{
+    cv::Mat normalizedInputFeature;
+    inputFeature.reshape(1, 1).convertTo(normalizedInputFeature, CV_32F);
+    normalize(normalizedInputFeature, normalizedInputFeature, 1.0, 0.0, cv::NORM_L2);
 
-        // 调整图像大小
-        const int inputWidth = 112; // ResNet50 通常使用 112x112
-        const int inputHeight = 112;
-        cv::resize(processedImage, resizedImage, cv::Size(inputWidth, inputHeight));
-
-        // 转换为浮点型并归一化
-        cv::Mat float_img;
-        resizedImage.convertTo(float_img, CV_32F);
-        float_img = float_img / 255.0;
-
-        // 标准化
-        cv::Mat normalized;
-        cv::subtract(float_img, cv::Scalar(0.5, 0.5, 0.5), normalized);
-        cv::multiply(normalized, cv::Scalar(2.0, 2.0, 2.0), normalized);
-
-        // 创建 blob
-        cv::Mat blob = cv::dnn::blobFromImage(normalized,
-                                              1.0, // scalefactor
-                                              cv::Size(inputWidth, inputHeight),
-                                              cv::Scalar(0, 0, 0), // mean
-                                              true,                // swapRB
-                                              false);              // crop
-
-        // 打印 blob 的维度，用于调试
-        qDebug() << "Blob dimensions:" << blob.dims << blob.size[0] << blob.size[1] << blob.size[2] << blob.size[3];
-
-        // 设置网络输入
-        featureNet.setInput(blob);
-
-        // 获取网络输出层名称
-        std::vector<std::string> outNames = featureNet.getUnconnectedOutLayersNames();
-        if (outNames.empty())
-        {
-            qDebug() << "No output layers found";
-            return cv::Mat();
-        }
+    const QList<FaceIndex::Result> results = FaceIndex::getInstance().search(normalizedInputFeature.ptr<float>(),
+                                                                              normalizedInputFeature.cols, 1);
+    if (results.isEmpty())
+    {
+        qDebug() << "Face index is empty";
+        return false;
+    }
 
-        // 获取特征向量
-        std::vector<cv::Mat> outputs;
-        featureNet.forward(outputs, outNames);
+    // 与 1:1 验证使用相同的阈值
+    const float THRESHOLD = 0.5;
+    usernum = results.first().usernum;
+    distance = results.first().distance;
+    qDebug() << "Nearest user:" << usernum << "distance:" << distance;
 
-        if (outputs.empty())
-        {
-            qDebug() << "No output produced";
-            return cv::Mat();
-        }
+    return distance < THRESHOLD;
+}
 
-        // 返回处理后的特征向量
-        cv::Mat featureVector = outputs[0].clone();
-        return featureVector.reshape(1, 1);
-    }
-    catch (const cv::Exception& e)
-    {
-        qDebug() << "OpenCV error:" << QString::fromStdString(e.what());
-        return cv::Mat();
-    }
-    catch (const std::exception& e)
-    {
-        qDebug() << "Error in extractFeatureVector:" << e.what();
-        return cv::Mat();
-    }
+bool ClientHandler::extractFeatureAsync(const cv::Mat& face, std::function<void(const cv::Mat&)> done,
+                                        FaceInferencePool::CancelToken cancel)
+{
+    std::weak_ptr<ClientHandler> weakSelf = weak_from_this();
+    return FaceInferencePool::getInstance().submit(face, [weakSelf, done = std::move(done)](const cv::Mat& feature)
+                                                   {
+                                                       // 在推理线程回调，连接已断开则丢弃，否则切回连接所属线程继续处理
+                                                       std::shared_ptr<ClientHandler> self = weakSelf.lock();
+                                                       if (!self)
+                                                       {
+                                                           return;
+                                                       }
+                                                       QMetaObject::invokeMethod(self.get(), [self, done, feature]()
+                                                                                 { done(feature); }, Qt::QueuedConnection); },
+                                                   std::move(cancel));
 }
 
 void ClientHandler::forwordKickedOffline(const QJsonObject& json) // 把在线用户挤下线
@@ -5,22 +5,37 @@
 #include <QJsonDocument>
 #include <QMutex>
 #include <QObject>
+#include <QPointer>
 #include <QQueue>
 #include <QRandomGenerator>
 #include <QReadWriteLock>
 #include <QTcpSocket>
-#include <QTimer>
 #include <opencv2/opencv.hpp>
 
+#include <atomic>
+#include <functional>
+#include <memory>
+
 #include "connectionpool.h"
+#include "faceinferencepool.h"
+#include "framecodec.h"
+#include "mailbox.h"
+#include "timingwheel.h"
 
 class Server;
 
-class ClientHandler : public QObject
+class ClientHandler : public QObject, public std::enable_shared_from_this<ClientHandler>
 {
     Q_OBJECT
 
 public:
+    // 发送队列超过上限时的处理策略
+    enum class SlowConsumerPolicy
+    {
+        Drop,      // 丢弃尚未写入 socket 的消息
+        Disconnect // 直接断开连接
+    };
+
     // Constructor & Destructor
     ClientHandler(QTcpSocket* socket, ConnectionPool& pool, Server* srv);
     ~ClientHandler();
@@ -28,6 +43,10 @@ public:
     // Database operations
     bool databasesConnect();
 
+    // Heartbeat
+    void attachTimingWheel(TimingWheel* timingWheel);
+    void onHeartbeatTimeout();
+
     // Socket handling
     void onReadyRead();
     void onDisconnected();
@@ -35,53 +54,79 @@ public:
     void handleSocketError(QAbstractSocket::SocketError error);
 
     // JSON message processing
-    void processRequest(const QJsonObject& jsonObj);
+    void processRequest(const Message& message);
+    void dealHello(const QJsonObject& json); // 协商协议版本
+    void post(const QJsonObject& message); // 线程安全，其它线程投递消息，在所属线程处理
     void receiveMessage(const QJsonObject& json);
     void notifyClientShutdown(const QJsonObject& json); // 服务器关闭通知客户端
-    void sendJsonResponse(const QJsonObject& responseJson);
+    void sendJsonResponse(const QJsonObject& responseJson, const Attachments& attachments = Attachments());
+    void enqueueFrame(const QByteArray& frame);
     void processMessageQueue();
+    void onBytesWritten(qint64 bytes);
+    qint64 pendingOutboundBytes() const;
+    void setWriteWatermarks(qint64 low, qint64 high);
+    void setSlowConsumerLimit(qint64 maxBytes, SlowConsumerPolicy policy);
     void sendErrorResponse(QJsonObject qjsonObj, const QString& reason);
     void cleanup();
 
     // Client request handlers
     void dealLogin(const QJsonObject& json);
-    void dealRegister(const QJsonObject& json);
+    void dealRegister(const QJsonObject& json, const QByteArray& avatarData);
     void dealSearchTerm(const QJsonObject& json);
     void dealContainsFace(const QJsonObject& json);
-    void dealCheckFace(const QJsonObject& json);
-    void dealUpdateFace(const QJsonObject& json);
+    void dealCheckFace(const QJsonObject& json, const QByteArray& imageData, bool preCropped);
+    void dealUpdateFace(const QJsonObject& json, const QByteArray& imageData, bool preCropped);
+    void dealIdentifyFace(const QJsonObject& json, const QByteArray& imageData, bool preCropped); // 1:N 识别
+    void dealCheckFaceStream(const QJsonObject& json, const QByteArray& imageData, bool preCropped); // 流式验证
+    void finishFaceStream(bool success);
 
     // Client-to-client communication
     void forwordKickedOffline(const QJsonObject& json);
 
     // Face recognition utilities
-    cv::Mat QImageToCvMat(const QImage& Image);
-    cv::Mat extractFeatureVector(const cv::Mat& face);
-    bool verifyIdentity(const cv::Mat& inputFeature, const std::string& filename);
-    bool saveFeatureVector(const cv::Mat& featureVector, const std::string& filename);
+    bool extractFeatureAsync(const cv::Mat& face, std::function<void(const cv::Mat&)> done,
+                             FaceInferencePool::CancelToken cancel = FaceInferencePool::CancelToken()); // 回调在本线程执行
+    bool detectFace(const QByteArray& imageData, bool preCropped, cv::Mat& face, QString& reason); // 失败时 reason 为回复客户端的原因
+    bool checkFaceQuality(const cv::Mat& face, double faceRatio, QString& reason);
+    bool verifyIdentity(const cv::Mat& inputFeature, const QString& usernum);
+    bool identifyUser(const cv::Mat& inputFeature, QString& usernum, float& distance);
+    bool saveFeatureVector(const cv::Mat& featureVector, const QString& usernum);
 
     bool insertUserRecord(const QString& usernum, const QString& password, const QString& nickname, const QString& avatar);
-    QString handleAvatar(const QString& usernum, const QJsonObject& json);
+    QString handleAvatar(const QString& usernum, const QByteArray& imageData);
     QString generateUniqueUsernum();
     bool checkNicknameAvailable(const QString& nickname);
 
-    QString loadAvatarAsBase64(const QString &avatarFilename);
+    QByteArray loadAvatarData(const QString& avatarFilename);
 signals:
-    void dataReceived(const QJsonObject& jsonObject);
+    void dataReceived(const Message& message);
 
     void sendMessage(const QJsonObject& jsonObject);
 
+    void slowConsumer(const QString& account, qint64 pendingBytes);
+
 private:
     // Synchronization
     QMutex dbMutex;
-    QMutex socketMutex;
     QReadWriteLock lock;
 
     // Network
     QTcpSocket* m_socket;
     QQueue<QByteArray> messageQueue;
-    bool isSending{false};
-    QByteArray buffer;
+    qint64 queuedBytes{0};     // messageQueue 中尚未交给 socket 的字节数
+    bool flushScheduled{false}; // 同一轮事件循环内的多次发送合并为一次写入
+    bool readPaused{false};     // 发送积压超过高水位时暂停处理新请求
+    FrameDecoder decoder;
+    CodecOptions peerOptions; // 与客户端协商后的协议版本、负载编码与压缩
+
+    // Backpressure
+    qint64 lowWatermark{LOW_WATERMARK};
+    qint64 highWatermark{HIGH_WATERMARK};
+    qint64 maxOutboundBytes{MAX_OUTBOUND_BYTES};
+    SlowConsumerPolicy slowConsumerPolicy{SlowConsumerPolicy::Disconnect};
+    static constexpr qint64 LOW_WATERMARK = 64 * 1024;
+    static constexpr qint64 HIGH_WATERMARK = 256 * 1024;
+    static constexpr qint64 MAX_OUTBOUND_BYTES = 16 * 1024 * 1024;
 
     // Database
     QSqlDatabase db;
@@ -94,13 +139,39 @@ private:
     // User data
     QString randomNumber;
     QString account{"0"};
-
-    // Face recognition
-    cv::CascadeClassifier faceCascade;
+    QString accountRole; // 登录账号的角色，未登录时为空
+
+    // Mailbox
+    // 踢下线、关服通知与服务器推送都经由信箱转交到所属线程，不直接操作其它线程的 socket
+    void drainMailbox();
+    Mailbox<QJsonObject> mailbox;
+    std::atomic<bool> drainScheduled{false};
+
+    // Face stream
+    // 流式验证：客户端按固定帧率连续上传，检测在本线程逐帧进行，特征提取最多同时 STREAM_MAX_IN_FLIGHT 帧，
+    // 任一帧通过即回复成功并取消排队中的帧；客户端发送 end 或帧数达到上限后，所有帧都未通过才回复失败
+    struct FaceStream
+    {
+        qint64 id{-1};
+        QString usernum;
+        int frames{0};
+        int inFlight{0};
+        bool ended{false};    // 不再接收新帧
+        bool finished{false}; // 已回复结果
+        QString lastReason;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+    FaceStream faceStream; // 只在所属线程访问
+    static constexpr int STREAM_MAX_IN_FLIGHT = 2;
+    static constexpr int STREAM_MAX_FRAMES = 50;
 
     // Heartbeat
-    QTimer* heartbeatTimer;
-    int missedHeartbeats;
+    // 由所在反应器的时间轮驱动，只有连接静默满一个周期才会触发
+    QPointer<TimingWheel> wheel;
+    TimingWheel::TimerId heartbeatTimerId{0};
+    qint64 lastActivity{0}; // 最近一次收到数据的时间
+    qint64 lastSent{0};     // 最近一次发出数据的时间，用于判断是否需要回应客户端心跳
+    int missedHeartbeats{0};
     static constexpr int MAX_MISSED_HEARTBEATS = 3;
     static constexpr int HEARTBEAT_INTERVAL = 5000;
 };
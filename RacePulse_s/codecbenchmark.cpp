@@ -0,0 +1,188 @@
+#include "codecbenchmark.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <functional>
+#include <random>
+
+#include "framecodec.h"
+#include "qdebug.h"
+
+namespace
+{
+constexpr qint64 MIN_MEASURE_NS = 200 * 1000 * 1000; // 每项至少测 200ms
+constexpr int MIN_ITERATIONS = 20;
+
+// 平均每次耗时（微秒）
+double averageUs(const std::function<void()>& operation)
+{
+    int iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    while (iterations < MIN_ITERATIONS || timer.nsecsElapsed() < MIN_MEASURE_NS)
+    {
+        operation();
+        ++iterations;
+    }
+    return timer.nsecsElapsed() / 1e3 / iterations;
+}
+
+// 与 dealSearchTerm 的应答字段一致
+QJsonObject searchResponse(int rows)
+{
+    QJsonArray results;
+    for (int i = 0; i < rows; ++i)
+    {
+        QJsonObject contest;
+        contest["contest_id"] = QString::number(10000 + i);
+        contest["contest_name"] = QString("第%1届校园马拉松（%2组）").arg(i + 1).arg(i % 2 ? "男子" : "女子");
+        contest["contest_logo"] = QString("contest_%1.png").arg(10000 + i);
+        contest["start_time"] = "2024-06-01 08:00:00";
+        contest["end_time"] = "2024-06-01 12:00:00";
+        contest["creator_nickname"] = QString("组织者%1").arg(i % 17);
+        contest["description"] = "全程 42.195 公里，沿东区体育场出发，途经图书馆、湖滨路，终点设在西区田径场。请提前一小时到场检录。";
+        contest["status"] = i % 3 ? "报名中" : "已结束";
+        contest["contest_password"] = "";
+        results.append(contest);
+    }
+
+    QJsonObject json;
+    json["search_term"] = "马拉松";
+    json["page_num"] = 1;
+    json["page_size"] = rows;
+    json["total_count"] = 1000;
+    json["total_pages"] = (1000 + rows - 1) / rows;
+    json["results"] = results;
+    json["tag"] = "home";
+    json["mode"] = "search_term";
+    return json;
+}
+
+// 与 dealLogin 的应答字段一致，头像为已压缩的图片数据，用随机字节模拟
+QJsonObject loginResponse(Attachments& attachments, int avatarBytes)
+{
+    QByteArray avatar(avatarBytes, Qt::Uninitialized);
+    std::mt19937 rng(7);
+    for (char& byte : avatar)
+    {
+        byte = char(rng() & 0xff);
+    }
+    attachments.insert("avatar_data", avatar);
+
+    QJsonObject json;
+    json["tag"] = "login";
+    json["result"] = "success";
+    json["usernum"] = "100000005";
+    json["nickname"] = "测试用户";
+    json["role"] = "参赛者";
+    return json;
+}
+
+CodecOptions v2Options(FrameType encoding)
+{
+    CodecOptions options;
+    options.version = PROTOCOL_V2;
+    options.encoding = encoding;
+    options.compression = Compression::None;
+    return options;
+}
+
+bool decodeFrame(const QByteArray& bytes, Message& message)
+{
+    FrameDecoder decoder;
+    decoder.append(bytes);
+    Frame frame;
+    return decoder.nextFrame(frame) && FrameCodec::decode(frame, message);
+}
+
+void report(const QString& name, const QJsonObject& json, const Attachments& attachments)
+{
+    const struct
+    {
+        const char* label;
+        CodecOptions options;
+    } encodings[] = {
+        {"v1 缩进 JSON", CodecOptions()},
+        {"v2 紧凑 JSON", v2Options(FrameType::Json)},
+        {"v2 CBOR", v2Options(FrameType::Cbor)},
+    };
+
+    for (const auto& encoding : encodings)
+    {
+        const QByteArray frame = FrameCodec::encode(json, encoding.options, attachments);
+        Message message;
+        if (!decodeFrame(frame, message))
+        {
+            qWarning() << "解码失败:" << name << encoding.label;
+            continue;
+        }
+
+        const double encodeUs = averageUs([&]()
+                                          { FrameCodec::encode(json, encoding.options, attachments); });
+        const double decodeUs = averageUs([&]()
+                                          { decodeFrame(frame, message); });
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5")
+                                 .arg(name, -20)
+                                 .arg(encoding.label, -14)
+                                 .arg(frame.size(), 9)
+                                 .arg(encodeUs, 10, 'f', 1)
+                                 .arg(decodeUs, 10, 'f', 1);
+    }
+}
+// v2 负载（不含帧头、未压缩），即 FrameCodec::encode 决定是否压缩的数据
+QByteArray payloadOf(const QJsonObject& json, FrameType encoding, const Attachments& attachments)
+{
+    return FrameCodec::encode(json, v2Options(encoding), attachments).mid(FRAME_HEADER_SIZE);
+}
+
+void reportCompression(const QString& name, const QJsonObject& json, const Attachments& attachments)
+{
+    for (const FrameType encoding : {FrameType::Json, FrameType::Cbor})
+    {
+        const QByteArray payload = payloadOf(json, encoding, attachments);
+        const QByteArray packed = qCompress(payload);
+
+        const double compressUs = averageUs([&]()
+                                            { qCompress(payload); });
+        const double uncompressUs = averageUs([&]()
+                                              { qUncompress(packed); });
+        const qint64 saved = qint64(payload.size()) - packed.size();
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7")
+                                 .arg(name, -20)
+                                 .arg(FrameCodec::encodingName(encoding), -5)
+                                 .arg(payload.size(), 9)
+                                 .arg(packed.size(), 9)
+                                 .arg(payload.isEmpty() ? 0.0 : 100.0 * saved / payload.size(), 7, 'f', 1)
+                                 .arg(compressUs, 10, 'f', 1)
+                                 .arg(uncompressUs, 10, 'f', 1);
+    }
+}
+} // namespace
+
+int CodecBenchmark::run()
+{
+    qInfo().noquote() << "消息                 编码            帧字节    编码us    解码us";
+    report("搜索应答 100 条", searchResponse(100), Attachments());
+
+    // v1 下附件以 Base64 写入 JSON，v2 作为二进制附件
+    Attachments avatar;
+    const QJsonObject login = loginResponse(avatar, 64 * 1024);
+    report("登录应答 64KB 头像", login, avatar);
+
+    // 节省为负表示压缩后反而变大，encode 此时发送原始负载
+    qInfo().noquote() << "";
+    qInfo().noquote() << QString("当前压缩阈值 protocol/compress_threshold = %1 字节").arg(FrameCodec::compressThreshold());
+    qInfo().noquote() << "负载                 编码   原始字节  压缩字节   节省%  压缩us  解压us";
+
+    QJsonObject heartbeat;
+    heartbeat["tag"] = "heartbeat";
+    reportCompression("心跳", heartbeat, Attachments());
+    for (const int rows : {1, 5, 10, 20, 50, 100})
+    {
+        reportCompression(QString("搜索应答 %1 条").arg(rows), searchResponse(rows), Attachments());
+    }
+    reportCompression("登录应答 64KB 头像", login, avatar);
+    return 0;
+}
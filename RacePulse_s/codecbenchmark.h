@@ -0,0 +1,15 @@
+#ifndef CODECBENCHMARK_H
+#define CODECBENCHMARK_H
+
+// 消息编码与压缩对比，命令行运行：RacePulse_s --bench-codec
+// 按真实应答的结构构造 100 条结果的赛事搜索应答与带头像的登录应答，
+// 输出 v1 缩进 JSON、v2 紧凑 JSON、v2 CBOR 的帧字节数、编码与解码耗时；
+// 再对心跳、不同条数的搜索应答与登录应答的 v2 负载输出压缩前后字节数与 qCompress/qUncompress 耗时，
+// 用于选择 protocol/compress_threshold
+class CodecBenchmark
+{
+public:
+    static int run();
+};
+
+#endif // CODECBENCHMARK_H
@@ -0,0 +1,282 @@
+#include "connectionbenchmark.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QHostAddress>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QThread>
+#include <QTimer>
+
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "qdebug.h"
+#include "reactorpool.h"
+
+namespace
+{
+constexpr int HEARTBEAT_INTERVAL = 5000; // 与 ClientHandler 一致
+constexpr int CONNECT_BATCH = 256;       // 每批发起的连接数，避免超出监听队列
+constexpr int CONNECT_TIMEOUT_MS = 120000;
+
+// 服务端的一个空闲连接：只持有 socket，读到数据直接丢弃
+class IdleConnection : public QObject
+{
+public:
+    explicit IdleConnection(QTcpSocket* socket)
+        : socket(socket)
+    {
+        socket->setParent(this);
+        connect(socket, &QTcpSocket::readyRead, this, [socket]()
+                { socket->readAll(); });
+    }
+
+    ~IdleConnection()
+    {
+        if (wheel && timerId)
+        {
+            wheel->cancel(timerId);
+        }
+    }
+
+    // 原来的做法：每个连接一个心跳 QTimer
+    void startHeartbeatTimer()
+    {
+        QTimer* timer = new QTimer(this);
+        timer->start(HEARTBEAT_INTERVAL);
+    }
+
+    // 现在的做法：心跳挂在反应器线程的时间轮上，到期后重新登记，需在反应器线程中调用
+    void attachTimingWheel(TimingWheel* timingWheel)
+    {
+        wheel = timingWheel;
+        timerId = wheel->schedule(HEARTBEAT_INTERVAL, [this]()
+                                  { attachTimingWheel(wheel); });
+    }
+
+private:
+    QTcpSocket* socket;
+    TimingWheel* wheel = nullptr;
+    TimingWheel::TimerId timerId = 0;
+};
+
+enum class Mode
+{
+    ThreadPerConnection,
+    Reactors
+};
+
+struct Usage
+{
+    qint64 rssKb = -1;
+    int threads = -1;
+    qint64 voluntary = -1;
+    qint64 involuntary = -1;
+};
+
+Usage currentUsage()
+{
+    Usage usage;
+#ifdef Q_OS_LINUX
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly))
+    {
+        for (const QByteArray& line : status.readAll().split('\n'))
+        {
+            if (line.startsWith("VmRSS:"))
+            {
+                usage.rssKb = line.mid(6).trimmed().split(' ').first().toLongLong();
+            }
+            else if (line.startsWith("Threads:"))
+            {
+                usage.threads = line.mid(8).trimmed().toInt();
+            }
+        }
+    }
+#endif
+#ifdef Q_OS_UNIX
+    rusage self;
+    if (getrusage(RUSAGE_SELF, &self) == 0)
+    {
+        usage.voluntary = self.ru_nvcsw;
+        usage.involuntary = self.ru_nivcsw;
+    }
+#endif
+    return usage;
+}
+
+// 每个连接两个描述符（客户端与服务端都在本进程），尽量调高上限
+void raiseDescriptorLimit(int connections)
+{
+#ifdef Q_OS_UNIX
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        const rlim_t wanted = rlim_t(connections) * 2 + 256;
+        if (limit.rlim_cur < wanted)
+        {
+            limit.rlim_cur = qMin(wanted, limit.rlim_max);
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+#else
+    Q_UNUSED(connections);
+#endif
+}
+
+void waitEvents(int milliseconds)
+{
+    QEventLoop loop;
+    QTimer::singleShot(milliseconds, &loop, &QEventLoop::quit);
+    loop.exec();
+}
+
+QString formatCount(qint64 value)
+{
+    return value < 0 ? QString("-") : QString::number(value);
+}
+
+// 建立 connections 个空闲连接，空闲 idleSeconds 秒，返回是否全部连接成功
+bool measure(Mode mode, int connections, int idleSeconds)
+{
+    QTcpServer server;
+    server.setMaxPendingConnections(CONNECT_BATCH * 2);
+    if (!server.listen(QHostAddress::LocalHost, 0))
+    {
+        qWarning() << "监听回环地址失败:" << server.errorString();
+        return false;
+    }
+
+    const Usage before = currentUsage();
+
+    ReactorPool* reactors = mode == Mode::Reactors ? new ReactorPool() : nullptr;
+    std::vector<QThread*> threads;
+    std::vector<IdleConnection*> accepted;
+    accepted.reserve(connections);
+
+    QObject::connect(&server, &QTcpServer::newConnection, [&]()
+                     {
+                         while (QTcpSocket* socket = server.nextPendingConnection())
+                         {
+                             IdleConnection* connection = new IdleConnection(socket);
+                             accepted.push_back(connection);
+                             if (reactors)
+                             {
+                                 Reactor* reactor = reactors->nextReactor();
+                                 reactor->attach();
+                                 connection->moveToThread(reactor->thread());
+                                 TimingWheel* wheel = reactor->timingWheel();
+                                 QMetaObject::invokeMethod(connection, [connection, wheel]()
+                                                           { connection->attachTimingWheel(wheel); }, Qt::QueuedConnection);
+                             }
+                             else
+                             {
+                                 QThread* thread = new QThread();
+                                 connection->startHeartbeatTimer();
+                                 connection->moveToThread(thread);
+                                 thread->start();
+                                 threads.push_back(thread);
+                             }
+                         } });
+
+    std::vector<QTcpSocket*> clients;
+    clients.reserve(connections);
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = true;
+    while (ok && (int(accepted.size()) < connections || int(clients.size()) < connections))
+    {
+        // 上一批都被接受后再发起下一批
+        if (int(clients.size()) < connections && accepted.size() == clients.size())
+        {
+            const int batch = qMin(CONNECT_BATCH, connections - int(clients.size()));
+            for (int i = 0; i < batch; ++i)
+            {
+                QTcpSocket* client = new QTcpSocket();
+                client->connectToHost(QHostAddress::LocalHost, server.serverPort());
+                clients.push_back(client);
+            }
+        }
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+        ok = timer.elapsed() < CONNECT_TIMEOUT_MS;
+    }
+
+    if (ok)
+    {
+        // 等连接登记完成、内存稳定后再开始计数
+        waitEvents(1000);
+        const Usage idleStart = currentUsage();
+        waitEvents(idleSeconds * 1000);
+        const Usage idleEnd = currentUsage();
+
+        const auto perSecond = [idleSeconds](qint64 start, qint64 end)
+        {
+            return start < 0 || end < 0 ? QString("-") : QString::number(double(end - start) / idleSeconds, 'f', 1);
+        };
+        const qint64 rssDelta = before.rssKb < 0 || idleStart.rssKb < 0 ? -1 : idleStart.rssKb - before.rssKb;
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7")
+                                 .arg(mode == Mode::Reactors ? "反应器" : "每连接一线程", -12)
+                                 .arg(connections, 7)
+                                 .arg(formatCount(idleStart.threads), 7)
+                                 .arg(rssDelta < 0 ? QString("-") : QString::number(rssDelta / 1024.0, 'f', 1), 10)
+                                 .arg(rssDelta < 0 ? QString("-") : QString::number(double(rssDelta) / connections, 'f', 1), 11)
+                                 .arg(perSecond(idleStart.voluntary, idleEnd.voluntary), 13)
+                                 .arg(perSecond(idleStart.involuntary, idleEnd.involuntary), 15);
+    }
+    else
+    {
+        qWarning() << "建立连接超时，已接受" << accepted.size() << "/" << connections << "（可能超出描述符或线程数上限）";
+    }
+
+    // 连接在各自线程中销毁：线程退出时处理 deleteLater
+    for (IdleConnection* connection : accepted)
+    {
+        connection->deleteLater();
+    }
+    for (QThread* thread : threads)
+    {
+        thread->quit();
+    }
+    for (QThread* thread : threads)
+    {
+        thread->wait();
+        delete thread;
+    }
+    delete reactors;
+    qDeleteAll(clients);
+    QCoreApplication::processEvents();
+    return ok;
+}
+} // namespace
+
+int ConnectionBenchmark::run(int idleSeconds)
+{
+    const QList<int> counts = {100, 1000, 10000};
+    raiseDescriptorLimit(counts.last());
+
+    qInfo().noquote() << QString("回环空闲连接，空闲观察 %1 秒，心跳间隔 %2 ms，CPU 线程数 %3")
+                             .arg(idleSeconds)
+                             .arg(HEARTBEAT_INTERVAL)
+                             .arg(QThread::idealThreadCount());
+    qInfo().noquote() << "内存增量包含本进程内客户端 socket 的开销，两种模式相同，差值即服务端承载方式的差别";
+    qInfo().noquote() << "模式            连接数   线程数  内存增量MB  每连接KB  自愿切换/s  非自愿切换/s";
+
+    int failures = 0;
+    for (const int connections : counts)
+    {
+        for (const Mode mode : {Mode::ThreadPerConnection, Mode::Reactors})
+        {
+            if (!measure(mode, connections, qMax(1, idleSeconds)))
+            {
+                ++failures;
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
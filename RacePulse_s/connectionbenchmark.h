@@ -0,0 +1,14 @@
+#ifndef CONNECTIONBENCHMARK_H
+#define CONNECTIONBENCHMARK_H
+
+// 空闲连接开销对比，命令行运行：RacePulse_s --bench-connections [空闲观察秒数，默认 10]
+// 本进程内在回环地址上建立 100、1000、10000 个不收发数据的客户端连接，服务端分别按
+// 原来的每连接一个线程 + 一个心跳 QTimer，以及现在的反应器线程 + 共用时间轮承载，
+// 输出线程数、常驻内存增量，以及空闲期间每秒的自愿/非自愿上下文切换次数（Linux 读取 /proc 与 getrusage）
+class ConnectionBenchmark
+{
+public:
+    static int run(int idleSeconds);
+};
+
+#endif // CONNECTIONBENCHMARK_H
@@ -0,0 +1,163 @@
+#include "contestpreloader.h"
+
+#include <QDateTime>
+#include <QMutexLocker>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThreadPool>
+
+#include "connectionpool.h"
+#include "faceembeddingstore.h"
+#include "qdebug.h"
+
+ContestPreloader::ContestPreloader(QObject* parent)
+    : QObject(parent)
+    , timer(new QTimer(this))
+{
+    connect(timer, &QTimer::timeout, this, &ContestPreloader::refresh);
+}
+
+ContestPreloader::~ContestPreloader()
+{
+}
+
+void ContestPreloader::start()
+{
+    timer->start(qMax(1, pollSeconds) * 1000);
+    refresh();
+}
+
+void ContestPreloader::stop()
+{
+    timer->stop();
+}
+
+void ContestPreloader::refresh()
+{
+    ConnectionPool& pool = ConnectionPool::getInstance();
+    QSqlDatabase db = pool.getConnection();
+    if (!db.isValid())
+    {
+        qDebug() << "预热人脸特征：获取数据库连接失败";
+        return;
+    }
+
+    // 即将开始或正在进行的赛事
+    const QDateTime now = QDateTime::currentDateTime();
+    QSqlQuery qry(db);
+    qry.prepare("SELECT contest_id, end_time FROM contest WHERE start_time <= :horizon AND end_time >= :now");
+    qry.bindValue(":horizon", now.addSecs(qint64(leadMinutes) * 60));
+    qry.bindValue(":now", now);
+    if (!qry.exec())
+    {
+        qDebug() << "查询赛事失败:" << qry.lastError().text();
+        pool.releaseConnection(db);
+        return;
+    }
+
+    QHash<QString, QDateTime> active; // 赛事 -> 结束时间
+    while (qry.next())
+    {
+        active.insert(qry.value("contest_id").toString(), qry.value("end_time").toDateTime());
+    }
+
+    FaceEmbeddingStore& store = FaceEmbeddingStore::getInstance();
+
+    // 新进入窗口的赛事，参赛者名单在本线程查询，读盘交给线程池
+    for (auto it = active.constBegin(); it != active.constEnd(); ++it)
+    {
+        if (preloaded.contains(it.key()))
+        {
+            continue;
+        }
+
+        // 分组名带序号，同一赛事释放后再次进入窗口时与上一次的任务互不影响
+        auto state = std::make_shared<PreloadState>();
+        state->group = QString("contest_%1#%2").arg(it.key()).arg(++preloadSerial);
+        state->endTime = it.value();
+        preloaded.insert(it.key(), state);
+
+        const QStringList usernums = participantsOf(db, it.key());
+        QThreadPool::globalInstance()->start([state, usernums]()
+                                             { pinContest(state, usernums); });
+    }
+
+    // 已结束（或被删除）的赛事释放常驻集合
+    for (auto it = preloaded.begin(); it != preloaded.end();)
+    {
+        if (active.contains(it.key()))
+        {
+            ++it;
+            continue;
+        }
+        releaseContest(*it.value());
+        it = preloaded.erase(it);
+    }
+
+    pool.releaseConnection(db);
+
+    const FaceEmbeddingStore::Stats stats = store.stats();
+    qDebug() << "人脸特征命中 常驻:" << stats.pinnedHits << "缓存:" << stats.cacheHits
+             << "读盘:" << stats.misses << "常驻用户:" << stats.pinnedUsers;
+}
+
+void ContestPreloader::pinContest(const std::shared_ptr<PreloadState>& state, const QStringList& usernums)
+{
+    // 任务排队期间赛事可能已被释放或已经结束
+    auto wanted = [&state]()
+    {
+        return !state->released && QDateTime::currentDateTime() <= state->endTime;
+    };
+    {
+        QMutexLocker locker(&state->mutex);
+        if (!wanted())
+        {
+            return;
+        }
+    }
+
+    // 读盘时不持有锁，不阻塞定时器所在的主线程
+    FaceEmbeddingStore& store = FaceEmbeddingStore::getInstance();
+    store.pin(state->group, usernums);
+
+    // 读盘期间被释放的赛事由本任务撤销，否则记录为已常驻，之后由定时器释放
+    QMutexLocker locker(&state->mutex);
+    if (!wanted())
+    {
+        store.unpin(state->group);
+        return;
+    }
+    state->pinned = true;
+}
+
+void ContestPreloader::releaseContest(PreloadState& state)
+{
+    QMutexLocker locker(&state.mutex);
+    state.released = true;
+    if (state.pinned)
+    {
+        FaceEmbeddingStore::getInstance().unpin(state.group);
+        state.pinned = false;
+    }
+}
+
+QStringList ContestPreloader::participantsOf(QSqlDatabase& db, const QString& contestId) const
+{
+    QStringList usernums;
+
+    QSqlQuery qry(db);
+    qry.prepare("SELECT u.usernum FROM participant p JOIN User u ON p.user_id = u.user_id "
+                "WHERE p.contest_id = :contest_id");
+    qry.bindValue(":contest_id", contestId);
+    if (!qry.exec())
+    {
+        qDebug() << "查询参赛人员失败:" << qry.lastError().text();
+        return usernums;
+    }
+
+    while (qry.next())
+    {
+        usernums.append(qry.value("usernum").toString());
+    }
+    return usernums;
+}
@@ -0,0 +1,57 @@
+#ifndef CONTESTPRELOADER_H
+#define CONTESTPRELOADER_H
+
+#include <QDateTime>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSettings>
+#include <QSqlDatabase>
+#include <QTimer>
+
+#include <memory>
+
+// 赛事签到前预热人脸特征
+// 定时扫描赛事表，赛事开始前 leadMinutes 分钟把全部参赛者的模板读入特征库的常驻集合，
+// 签到期间比对不再读盘；赛事结束后释放
+class ContestPreloader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ContestPreloader(QObject* parent = nullptr);
+    ~ContestPreloader();
+
+    void start();
+    void stop();
+
+public slots:
+    void refresh(); // 立即扫描一次
+
+private:
+    // 一次预热：常驻任务在线程池中执行，释放在定时器中执行，两者以 mutex 串行
+    struct PreloadState
+    {
+        QMutex mutex;
+        QString group;     // 常驻分组名
+        QDateTime endTime; // 赛事结束后不再常驻
+        bool pinned = false;
+        bool released = false;
+    };
+
+    static void pinContest(const std::shared_ptr<PreloadState>& state, const QStringList& usernums);
+    static void releaseContest(PreloadState& state);
+
+    QStringList participantsOf(QSqlDatabase& db, const QString& contestId) const;
+
+private:
+    // 使用配置文件
+    int leadMinutes = QSettings().value("face/preload_lead_min", 30).toInt();
+    int pollSeconds = QSettings().value("face/preload_poll_s", 60).toInt();
+
+    QTimer* timer;
+    QHash<QString, std::shared_ptr<PreloadState>> preloaded; // 已预热（或正在预热）的赛事
+    quint64 preloadSerial = 0;
+};
+
+#endif // CONTESTPRELOADER_H
@@ -0,0 +1,177 @@
+#include "embeddingbackend.h"
+
+#include <QSettings>
+#include <opencv2/dnn.hpp>
+
+#ifdef RACEPULSE_WITH_ONNXRUNTIME
+#include <onnxruntime_cxx_api.h>
+
+#include <array>
+#include <string>
+#endif
+
+namespace
+{
+// 每个推理后端实例使用的线程数，0 为库的默认值；推理线程有多个时注意总数不要超过核心数
+int backendThreads()
+{
+    static const int threads = qMax(0, QSettings().value("face/backend_threads", 0).toInt());
+    return threads;
+}
+
+class OpenCvEmbeddingBackend : public EmbeddingBackend
+{
+public:
+    explicit OpenCvEmbeddingBackend(const std::vector<uchar>& onnx)
+        : net(cv::dnn::readNetFromONNX(onnx))
+    {
+        if (net.empty())
+        {
+            CV_Error(cv::Error::StsError, "empty embedding network");
+        }
+        net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net.setPreferableTarget(target());
+
+        // OpenCV 的线程数是进程级设置，所有实例共用
+        if (backendThreads() > 0)
+        {
+            cv::setNumThreads(backendThreads());
+        }
+    }
+
+    const char* name() const override
+    {
+        return "opencv";
+    }
+
+    void run(float* blob, int count, cv::Mat* features) override
+    {
+        // 一批人脸共用一个 NCHW blob，一次 forward
+        const int sizes[] = {count, 3, INPUT_SIZE, INPUT_SIZE};
+        net.setInput(cv::Mat(4, sizes, CV_32F, blob));
+        cv::Mat output = net.forward();
+
+        // 输出为 N x D，每行一个特征向量
+        output = output.reshape(1, count);
+        for (int i = 0; i < count; ++i)
+        {
+            features[i] = output.row(i).clone();
+        }
+    }
+
+private:
+    // 配置 face/dnn_target：cpu（默认）、opencl、opencl_fp16
+    static int target()
+    {
+        const QString name = QSettings().value("face/dnn_target", "cpu").toString();
+        if (name == "opencl")
+        {
+            return cv::dnn::DNN_TARGET_OPENCL;
+        }
+        if (name == "opencl_fp16")
+        {
+            return cv::dnn::DNN_TARGET_OPENCL_FP16;
+        }
+        return cv::dnn::DNN_TARGET_CPU;
+    }
+
+    cv::dnn::Net net;
+};
+
+#ifdef RACEPULSE_WITH_ONNXRUNTIME
+class OnnxRuntimeEmbeddingBackend : public EmbeddingBackend
+{
+public:
+    explicit OnnxRuntimeEmbeddingBackend(const std::vector<uchar>& onnx)
+        : session(env(), onnx.data(), onnx.size(), options())
+    {
+        Ort::AllocatorWithDefaultOptions allocator;
+        inputName = session.GetInputNameAllocated(0, allocator).get();
+        outputName = session.GetOutputNameAllocated(0, allocator).get();
+    }
+
+    const char* name() const override
+    {
+        return "onnxruntime";
+    }
+
+    void run(float* blob, int count, cv::Mat* features) override
+    {
+        // 直接引用 blob 内存，不拷贝输入
+        const std::array<int64_t, 4> shape{count, 3, INPUT_SIZE, INPUT_SIZE};
+        const Ort::MemoryInfo memory = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+        Ort::Value input = Ort::Value::CreateTensor<float>(memory, blob, size_t(count) * IMAGE_FLOATS, shape.data(), shape.size());
+
+        const char* inputNames[] = {inputName.c_str()};
+        const char* outputNames[] = {outputName.c_str()};
+        std::vector<Ort::Value> outputs = session.Run(Ort::RunOptions{nullptr}, inputNames, &input, 1, outputNames, 1);
+
+        const float* data = outputs[0].GetTensorData<float>();
+        const int dim = int(outputs[0].GetTensorTypeAndShapeInfo().GetElementCount() / size_t(count));
+        for (int i = 0; i < count; ++i)
+        {
+            features[i] = cv::Mat(1, dim, CV_32F, const_cast<float*>(data + size_t(i) * dim)).clone();
+        }
+    }
+
+private:
+    static Ort::Env& env()
+    {
+        static Ort::Env instance(ORT_LOGGING_LEVEL_WARNING, "RacePulse");
+        return instance;
+    }
+
+    static Ort::SessionOptions options()
+    {
+        Ort::SessionOptions options;
+        options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        options.SetInterOpNumThreads(1);
+        if (backendThreads() > 0)
+        {
+            options.SetIntraOpNumThreads(backendThreads());
+        }
+        return options;
+    }
+
+    Ort::Session session;
+    std::string inputName;
+    std::string outputName;
+};
+#endif
+} // namespace
+
+EmbeddingBackend::~EmbeddingBackend()
+{
+}
+
+std::unique_ptr<EmbeddingBackend> EmbeddingBackend::create(const QString& kind, const std::vector<uchar>& onnx, QString& error)
+{
+    try
+    {
+        if (kind == "opencv")
+        {
+            return std::make_unique<OpenCvEmbeddingBackend>(onnx);
+        }
+#ifdef RACEPULSE_WITH_ONNXRUNTIME
+        if (kind == "onnxruntime")
+        {
+            return std::make_unique<OnnxRuntimeEmbeddingBackend>(onnx);
+        }
+#endif
+        error = QString("不支持的推理后端: %1，可用: %2").arg(kind, available().join(", "));
+    }
+    catch (const std::exception& e)
+    {
+        error = QString::fromStdString(e.what());
+    }
+    return nullptr;
+}
+
+QStringList EmbeddingBackend::available()
+{
+    QStringList names{"opencv"};
+#ifdef RACEPULSE_WITH_ONNXRUNTIME
+    names << "onnxruntime";
+#endif
+    return names;
+}
@@ -0,0 +1,34 @@
+#ifndef EMBEDDINGBACKEND_H
+#define EMBEDDINGBACKEND_H
+
+#include <QString>
+#include <QStringList>
+#include <opencv2/core.hpp>
+
+#include <memory>
+#include <vector>
+
+// 人脸特征提取的推理后端
+// 输入为预处理好的 NCHW float32 blob，输出每张人脸一个 1xD 的 CV_32F 特征；
+// 实例不是线程安全的，每个推理线程各持一份。
+// 默认使用 OpenCV DNN；qmake 时加 CONFIG+=onnxruntime 可额外编译 ONNX Runtime 后端
+class EmbeddingBackend
+{
+public:
+    static constexpr int INPUT_SIZE = 112; // ResNet50 使用 112x112
+    static constexpr int IMAGE_FLOATS = 3 * INPUT_SIZE * INPUT_SIZE;
+
+    virtual ~EmbeddingBackend();
+
+    virtual const char* name() const = 0;
+
+    // blob 为 count x 3 x 112 x 112，推理失败时抛出 std::exception
+    virtual void run(float* blob, int count, cv::Mat* features) = 0;
+
+    // kind 为 "opencv" 或 "onnxruntime"，模型为内存中的 ONNX 数据；失败时返回空并写入原因
+    static std::unique_ptr<EmbeddingBackend> create(const QString& kind, const std::vector<uchar>& onnx, QString& error);
+
+    static QStringList available(); // 本次编译包含的后端
+};
+
+#endif // EMBEDDINGBACKEND_H
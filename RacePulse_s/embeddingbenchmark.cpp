@@ -0,0 +1,271 @@
+#include "embeddingbenchmark.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QThread>
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+#include "embeddingbackend.h"
+#include "faceinferencepool.h"
+#include "facemodelregistry.h"
+#include "qdebug.h"
+
+namespace
+{
+constexpr int WARMUP_RUNS = 3;
+constexpr int POOL_SUBMISSIONS = 512; // 线程池吞吐测试每种批大小提交的人脸数
+
+bool readModel(const QString& path, std::vector<uchar>& onnx)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+    const QByteArray data = file.readAll();
+    onnx.assign(data.begin(), data.end());
+    return true;
+}
+
+// 逐张推理，得到每张图的特征与耗时
+bool runSingles(EmbeddingBackend& backend, std::vector<float>& blob, int count, std::vector<cv::Mat>& features,
+                std::vector<qint64>& latencies)
+{
+    features.assign(size_t(count), cv::Mat());
+    latencies.clear();
+    try
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            backend.run(blob.data() + size_t(i) * EmbeddingBackend::IMAGE_FLOATS, 1, &features[i]);
+            latencies.push_back(timer.nsecsElapsed());
+        }
+    }
+    catch (const std::exception& e)
+    {
+        qWarning() << "推理失败:" << e.what();
+        return false;
+    }
+    return true;
+}
+
+double cosineDistance(const cv::Mat& a, const cv::Mat& b)
+{
+    const double denominator = cv::norm(a) * cv::norm(b);
+    return denominator > 0.0 ? 1.0 - a.dot(b) / denominator : 1.0;
+}
+
+// 经由 FaceInferencePool 的端到端吞吐：按不同批大小重启线程池，持续提交人脸直到全部完成，
+// 与服务端签到请求走的是同一条路径（当前配置的后端与精度）
+bool runPool(const std::vector<cv::Mat>& faces, int count)
+{
+    FaceInferencePool& pool = FaceInferencePool::getInstance();
+    const int submissions = qMax(POOL_SUBMISSIONS, count);
+    const int configured = pool.currentBatchSize();
+
+    qInfo().noquote() << QString("线程池：推理线程 %1，每种批大小提交 %2 张").arg(pool.workerCount()).arg(submissions);
+    qInfo().noquote() << "批大小  吞吐张/s  失败张数  回退逐张批数";
+
+    bool ok = true;
+    for (const int batchSize : {1, 4, 8, 16})
+    {
+        pool.stop();
+        pool.setBatchSize(batchSize);
+        pool.start();
+
+        // 预热完成后再计时，排除模型构建开销
+        std::atomic<bool> warmed{false};
+        if (pool.warmUp([&warmed]() { warmed.store(true, std::memory_order_release); }))
+        {
+            while (!warmed.load(std::memory_order_acquire))
+            {
+                QThread::msleep(1);
+            }
+        }
+
+        std::atomic<int> finished{0};
+        std::atomic<int> failed{0};
+        const quint64 fallbacksBefore = pool.fallbackCount();
+
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < submissions;)
+        {
+            const bool submitted = pool.submit(faces[size_t(i % count)], [&finished, &failed](const cv::Mat& feature)
+                                               {
+                                                   if (feature.empty())
+                                                   {
+                                                       failed.fetch_add(1, std::memory_order_relaxed);
+                                                   }
+                                                   finished.fetch_add(1, std::memory_order_release); });
+            if (submitted)
+            {
+                ++i;
+            }
+            else
+            {
+                QThread::usleep(200); // 队列已满
+            }
+        }
+        while (finished.load(std::memory_order_acquire) < submissions)
+        {
+            QThread::usleep(200);
+        }
+        const double seconds = timer.nsecsElapsed() / 1e9;
+        const quint64 fallbacks = pool.fallbackCount() - fallbacksBefore;
+
+        qInfo().noquote() << QString("%1 %2 %3 %4")
+                                 .arg(batchSize, 6)
+                                 .arg(seconds > 0.0 ? submissions / seconds : 0.0, 9, 'f', 1)
+                                 .arg(failed.load(), 9)
+                                 .arg(fallbacks, 13);
+        if (fallbacks > 0)
+        {
+            qWarning() << "批大小" << batchSize << "时模型不支持批量推理，吞吐为逐张推理的结果";
+        }
+        ok = ok && failed.load() == 0;
+    }
+
+    pool.stop();
+    pool.setBatchSize(configured);
+    return ok;
+}
+} // namespace
+
+int EmbeddingBenchmark::run(const QString& imageDirectory)
+{
+    // 读取固定图片集，按文件名排序保证每次顺序一致
+    QDir dir(imageDirectory);
+    QStringList files = dir.entryList({"*.jpg", "*.jpeg", "*.png", "*.bmp"}, QDir::Files, QDir::Name);
+    std::vector<float> blob(size_t(files.size()) * EmbeddingBackend::IMAGE_FLOATS);
+    std::vector<cv::Mat> faces;
+    cv::Mat resized;
+    int count = 0;
+    for (const QString& name : std::as_const(files))
+    {
+        const cv::Mat image = cv::imread(dir.filePath(name).toStdString(), cv::IMREAD_COLOR);
+        if (image.empty())
+        {
+            qWarning() << "跳过无法读取的图片:" << name;
+            continue;
+        }
+        FaceInferencePool::preprocess(image, resized, blob.data() + size_t(count) * EmbeddingBackend::IMAGE_FLOATS);
+        faces.push_back(image);
+        ++count;
+    }
+    if (count == 0)
+    {
+        qWarning() << "目录中没有可用的人脸图片:" << imageDirectory;
+        return 1;
+    }
+
+    FaceModelRegistry& registry = FaceModelRegistry::getInstance();
+    const int batchSize = qMax(1, QSettings().value("face/batch_size", 8).toInt());
+
+    // 基准：OpenCV DNN + fp32 模型
+    std::vector<uchar> onnx;
+    QString error;
+    if (!readModel(registry.embeddingModelFile("fp32"), onnx))
+    {
+        qWarning() << "无法读取 fp32 基准模型:" << registry.embeddingModelFile("fp32");
+        return 1;
+    }
+    std::unique_ptr<EmbeddingBackend> reference = EmbeddingBackend::create("opencv", onnx, error);
+    std::vector<cv::Mat> baseline;
+    std::vector<qint64> latencies;
+    if (!reference || !runSingles(*reference, blob, count, baseline, latencies))
+    {
+        qWarning() << "基准模型推理失败:" << error;
+        return 1;
+    }
+
+    qInfo().noquote() << QString("图片数 %1，批大小 %2").arg(count).arg(batchSize);
+    qInfo().noquote() << "后端        精度  加载ms  延迟中位ms  延迟P95ms  吞吐张/s  平均偏移  最大偏移";
+
+    for (const QString& backendName : EmbeddingBackend::available())
+    {
+        for (const QString& precision : {QString("fp32"), QString("fp16"), QString("int8")})
+        {
+            const QString path = registry.embeddingModelFile(precision);
+            if (!readModel(path, onnx))
+            {
+                continue; // 没有该精度的模型
+            }
+
+            QElapsedTimer loadTimer;
+            loadTimer.start();
+            std::unique_ptr<EmbeddingBackend> backend = EmbeddingBackend::create(backendName, onnx, error);
+            const qint64 loadMs = loadTimer.elapsed();
+            if (!backend)
+            {
+                qWarning() << backendName << precision << "加载失败:" << error;
+                continue;
+            }
+
+            // 预热，排除首次推理的初始化开销
+            std::vector<cv::Mat> features;
+            for (int i = 0; i < WARMUP_RUNS; ++i)
+            {
+                runSingles(*backend, blob, qMin(count, 1), features, latencies);
+            }
+
+            if (!runSingles(*backend, blob, count, features, latencies))
+            {
+                continue;
+            }
+            std::sort(latencies.begin(), latencies.end());
+            const double medianMs = latencies[latencies.size() / 2] / 1e6;
+            const double p95Ms = latencies[std::min(latencies.size() - 1, latencies.size() * 95 / 100)] / 1e6;
+
+            // 批量吞吐，模型不支持动态 batch 时如实标出，不用逐张推理的结果代替
+            std::vector<cv::Mat> batchFeatures(size_t(batchSize));
+            QString throughput;
+            QElapsedTimer batchTimer;
+            batchTimer.start();
+            try
+            {
+                for (int first = 0; first < count; first += batchSize)
+                {
+                    backend->run(blob.data() + size_t(first) * EmbeddingBackend::IMAGE_FLOATS, qMin(batchSize, count - first),
+                                 batchFeatures.data());
+                }
+                const double totalMs = batchTimer.nsecsElapsed() / 1e6;
+                throughput = QString::number(totalMs > 0.0 ? count * 1000.0 / totalMs : 0.0, 'f', 1);
+            }
+            catch (const std::exception& e)
+            {
+                qWarning() << backendName << precision << "不支持批量推理:" << e.what();
+                throughput = "不支持";
+            }
+
+            double meanDrift = 0.0;
+            double maxDrift = 0.0;
+            for (int i = 0; i < count; ++i)
+            {
+                const double drift = cosineDistance(features[i], baseline[i]);
+                meanDrift += drift;
+                maxDrift = std::max(maxDrift, drift);
+            }
+            meanDrift /= count;
+
+            qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+                                     .arg(backendName, -11)
+                                     .arg(precision, -5)
+                                     .arg(loadMs, 6)
+                                     .arg(medianMs, 10, 'f', 2)
+                                     .arg(p95Ms, 9, 'f', 2)
+                                     .arg(throughput, 8)
+                                     .arg(meanDrift, 8, 'f', 5)
+                                     .arg(maxDrift, 8, 'f', 5);
+        }
+    }
+
+    return runPool(faces, count) ? 0 : 1;
+}
@@ -0,0 +1,16 @@
+#ifndef EMBEDDINGBENCHMARK_H
+#define EMBEDDINGBENCHMARK_H
+
+#include <QString>
+
+// 推理后端与模型精度对比，命令行运行：RacePulse_s --bench-embedding <人脸图片目录>
+// 目录中放固定的一组人脸裁剪图，对每个可用后端与精度（fp32、fp16、int8）输出
+// 单张延迟（中位数、P95）、批量吞吐，以及特征与 OpenCV fp32 基准之间的余弦距离偏移；
+// 再经由 FaceInferencePool 在批大小 1、4、8、16 下测量每秒可完成的签到数，批量推理失败退回逐张时如实报告
+class EmbeddingBenchmark
+{
+public:
+    static int run(const QString& imageDirectory);
+};
+
+#endif // EMBEDDINGBENCHMARK_H
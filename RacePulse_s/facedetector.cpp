@@ -0,0 +1,89 @@
+#include "facedetector.h"
+
+#include <QSettings>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include <cmath>
+
+#include "facemodelregistry.h"
+
+int FaceDetector::workingWidth()
+{
+    static const int width = qMax(64, QSettings().value("face/detect_width", 320).toInt());
+    return width;
+}
+
+bool FaceDetector::detect(const cv::Mat& bgr, std::vector<Detection>& faces)
+{
+    faces.clear();
+    if (bgr.empty())
+    {
+        return true;
+    }
+
+    // 工作图按线程复用
+    thread_local cv::Mat small;
+    thread_local cv::Mat gray;
+
+    // 原图不够宽时直接在原图上检测
+    const double scale = std::min(1.0, double(workingWidth()) / bgr.cols);
+    const cv::Mat* working = &bgr;
+    if (scale < 1.0)
+    {
+        cv::resize(bgr, small, cv::Size(), scale, scale, cv::INTER_AREA);
+        working = &small;
+    }
+
+    FaceModelRegistry& registry = FaceModelRegistry::getInstance();
+    std::vector<Detection> found;
+
+    if (cv::Ptr<cv::FaceDetectorYN> yunet = registry.dnnDetector())
+    {
+        cv::Mat results;
+        yunet->setInputSize(working->size());
+        yunet->detect(*working, results);
+
+        // 每行：x, y, w, h, 5 个关键点, score
+        for (int i = 0; i < results.rows; ++i)
+        {
+            const float* row = results.ptr<float>(i);
+            found.push_back(Detection{cv::Rect(cvRound(row[0]), cvRound(row[1]), cvRound(row[2]), cvRound(row[3])), row[14]});
+        }
+    }
+    else
+    {
+        cv::CascadeClassifier& cascade = registry.detector();
+        if (cascade.empty())
+        {
+            return false;
+        }
+
+        cv::cvtColor(*working, gray, cv::COLOR_BGR2GRAY);
+        cv::equalizeHist(gray, gray);
+
+        // 原图上 30x30 的最小人脸按比例缩小，但不小于级联的 24x24 窗口
+        const int minSide = std::max(24, int(std::lround(30 * scale)));
+        std::vector<cv::Rect> boxes;
+        cascade.detectMultiScale(gray, boxes, 1.1, 3, 0, cv::Size(minSide, minSide));
+        for (const cv::Rect& box : boxes)
+        {
+            found.push_back(Detection{box, 1.0f});
+        }
+    }
+
+    // 映射回原图坐标并裁到图像范围内
+    const cv::Rect bounds(0, 0, bgr.cols, bgr.rows);
+    for (const Detection& detection : found)
+    {
+        const cv::Rect& box = detection.box;
+        cv::Rect mapped(int(std::floor(box.x / scale)), int(std::floor(box.y / scale)),
+                        int(std::ceil(box.width / scale)), int(std::ceil(box.height / scale)));
+        mapped &= bounds;
+        if (!mapped.empty())
+        {
+            faces.push_back(Detection{mapped, detection.score});
+        }
+    }
+    return true;
+}
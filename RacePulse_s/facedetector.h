@@ -0,0 +1,26 @@
+#ifndef FACEDETECTOR_H
+#define FACEDETECTOR_H
+
+#include <opencv2/core.hpp>
+
+#include <vector>
+
+// 人脸检测
+// 在按预期人脸大小缩小的工作图上检测，再把人脸框映射回原图坐标，裁剪仍在原图上进行；
+// 默认使用 Haar 级联，配置了 YuNet 模型（face/yunet_model）时改用 DNN 检测器
+class FaceDetector
+{
+public:
+    struct Detection
+    {
+        cv::Rect box; // 原图坐标
+        float score;  // DNN 检测器的置信度，Haar 级联固定为 1
+    };
+
+    // 返回 false 表示检测器不可用
+    static bool detect(const cv::Mat& bgr, std::vector<Detection>& faces);
+
+    static int workingWidth(); // 工作图宽度（face/detect_width），原图更窄时不缩放
+};
+
+#endif // FACEDETECTOR_H
@@ -0,0 +1,699 @@
+#include "faceembeddingstore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+
+#include "faceindex.h"
+#include "qdebug.h"
+
+namespace
+{
+// 文件头：magic "RPFE"，版本，维度，模板数，累计样本数，均为小端 quint32，之后是样本之和与模板
+// 版本 1 没有样本数与质心；版本 2 布局相同但存的是按样本数加权累计出的质心，权重有偏差。
+// 这两个版本读取时都由现有模板重新计算
+constexpr char EMB_MAGIC[4] = {'R', 'P', 'F', 'E'};
+constexpr quint32 EMB_VERSION = 3;
+constexpr int EMB_HEADER_SIZE = 20;
+constexpr quint32 EMB_VERSION_V2 = 2;
+constexpr quint32 EMB_VERSION_V1 = 1;
+constexpr int EMB_HEADER_SIZE_V1 = 16;
+
+// 转为单行 float32 并做 L2 归一化
+cv::Mat normalizedRow(const cv::Mat& feature)
+{
+    cv::Mat row;
+    feature.reshape(1, 1).convertTo(row, CV_32F);
+    cv::normalize(row, row, 1.0, 0.0, cv::NORM_L2);
+    return row;
+}
+
+std::vector<float> normalized(const std::vector<float>& vector)
+{
+    double norm = 0.0;
+    for (float v : vector)
+    {
+        norm += double(v) * v;
+    }
+    std::vector<float> result(vector);
+    if (norm > 0.0)
+    {
+        const float scale = float(1.0 / std::sqrt(norm));
+        for (float& v : result)
+        {
+            v *= scale;
+        }
+    }
+    return result;
+}
+
+// 由现有模板重新计算样本之和与质心
+void rebuildCentroid(FaceTemplates& templates)
+{
+    templates.sum.assign(size_t(templates.dim), 0.0f);
+    for (int i = 0; i < templates.count; ++i)
+    {
+        const float* row = templates.row(i);
+        for (int d = 0; d < templates.dim; ++d)
+        {
+            templates.sum[d] += row[d];
+        }
+    }
+    templates.centroid = normalized(templates.sum);
+    templates.samples = templates.count;
+}
+
+// 把一个新样本计入质心：累加到样本之和后重新归一化，每个样本权重相同，不需要保留被淘汰的模板
+void accumulateCentroid(FaceTemplates& templates, const float* row)
+{
+    if (templates.samples <= 0 || int(templates.sum.size()) != templates.dim)
+    {
+        templates.sum.assign(row, row + templates.dim);
+        templates.samples = 0;
+    }
+    else
+    {
+        for (int d = 0; d < templates.dim; ++d)
+        {
+            templates.sum[d] += row[d];
+        }
+    }
+    templates.centroid = normalized(templates.sum);
+    ++templates.samples;
+}
+
+// 只保留最近的 maxCount 个模板，返回是否丢弃了模板
+bool capTemplates(FaceTemplates& templates, int maxCount)
+{
+    if (templates.count <= maxCount)
+    {
+        return false;
+    }
+    const size_t dropped = size_t(templates.count - maxCount) * templates.dim;
+    templates.data.erase(templates.data.begin(), templates.data.begin() + dropped);
+    templates.count = maxCount;
+    return true;
+}
+} // namespace
+
+FaceEmbeddingStore& FaceEmbeddingStore::getInstance()
+{
+    static FaceEmbeddingStore instance;
+    return instance;
+}
+
+FaceEmbeddingStore::FaceEmbeddingStore()
+{
+    cache.setMaxCost(qMax<qint64>(1, cacheBytes));
+}
+
+FaceEmbeddingStore::~FaceEmbeddingStore()
+{
+}
+
+bool FaceEmbeddingStore::open()
+{
+    QDir dir(directory);
+    if (!dir.exists() && !dir.mkpath("."))
+    {
+        qWarning() << "无法创建人脸特征目录:" << directory;
+        return false;
+    }
+
+    QSet<QString> users;
+    const QFileInfoList binaries = dir.entryInfoList({"*.emb"}, QDir::Files);
+    for (const QFileInfo& info : binaries)
+    {
+        users.insert(info.completeBaseName());
+    }
+
+    // 旧版 YAML 特征文件迁移为二进制格式，原文件保留
+    int migrated = 0;
+    const QFileInfoList yamls = dir.entryInfoList({"*.yml"}, QDir::Files);
+    for (const QFileInfo& info : yamls)
+    {
+        const QString usernum = info.completeBaseName();
+        if (users.contains(usernum))
+        {
+            continue;
+        }
+        if (migrateYaml(info.filePath(), usernum))
+        {
+            users.insert(usernum);
+            ++migrated;
+        }
+    }
+
+    {
+        QWriteLocker locker(&indexLock);
+        enrolled = users;
+    }
+
+    // 全部模板建入 1:N 识别索引，之后随保存增量更新
+    FaceIndex& index = FaceIndex::getInstance();
+    index.clear();
+    for (const QString& usernum : users)
+    {
+        if (std::shared_ptr<const FaceTemplates> stored = readFile(pathFor(usernum)))
+        {
+            for (int i = 0; i < stored->count; ++i)
+            {
+                index.add(usernum, stored->row(i), stored->dim);
+            }
+        }
+    }
+
+    qDebug() << "人脸特征库用户数:" << users.size() << "本次迁移:" << migrated << "索引节点:" << index.size();
+    return true;
+}
+
+bool FaceEmbeddingStore::has(const QString& usernum) const
+{
+    QReadLocker locker(&indexLock);
+    return enrolled.contains(usernum);
+}
+
+std::shared_ptr<const FaceTemplates> FaceEmbeddingStore::templates(const QString& usernum)
+{
+    {
+        QReadLocker locker(&pinLock);
+        auto it = pinned.constFind(usernum);
+        if (it != pinned.constEnd() && it->templates)
+        {
+            pinnedHits.fetch_add(1, std::memory_order_relaxed);
+            return it->templates;
+        }
+    }
+
+    quint64 version = 0;
+    {
+        QMutexLocker locker(&cacheMutex);
+        if (auto* cached = cache.object(usernum))
+        {
+            cacheHits.fetch_add(1, std::memory_order_relaxed);
+            return *cached;
+        }
+        version = versions.value(usernum);
+    }
+
+    if (!has(usernum))
+    {
+        return nullptr;
+    }
+
+    // 读盘时不持有锁，期间被保存或删除过时不放入缓存，避免旧数据被缓存后又被 append 写回
+    misses.fetch_add(1, std::memory_order_relaxed);
+    std::shared_ptr<const FaceTemplates> loaded = readFile(pathFor(usernum));
+    if (loaded)
+    {
+        cacheInsert(usernum, loaded, version);
+    }
+    return loaded;
+}
+
+bool FaceEmbeddingStore::append(const QString& usernum, const cv::Mat& feature)
+{
+    return store(usernum, feature, true);
+}
+
+bool FaceEmbeddingStore::replace(const QString& usernum, const cv::Mat& feature)
+{
+    return store(usernum, feature, false);
+}
+
+bool FaceEmbeddingStore::store(const QString& usernum, const cv::Mat& feature, bool keepExisting)
+{
+    if (feature.empty())
+    {
+        return false;
+    }
+    const cv::Mat row = normalizedRow(feature);
+
+    QMutexLocker locker(&writeMutex);
+
+    auto updated = std::make_shared<FaceTemplates>();
+    std::shared_ptr<const FaceTemplates> current = keepExisting ? templates(usernum) : nullptr;
+    if (current && current->dim == row.cols)
+    {
+        *updated = *current;
+    }
+    else if (current)
+    {
+        qWarning() << "特征维度变化，丢弃用户" << usernum << "的旧模板";
+    }
+
+    updated->dim = row.cols;
+    accumulateCentroid(*updated, row.ptr<float>());
+    updated->data.insert(updated->data.end(), row.ptr<float>(), row.ptr<float>() + row.cols);
+    ++updated->count;
+    const bool evicted = capTemplates(*updated, maxTemplates);
+
+    if (!writeFile(pathFor(usernum), *updated))
+    {
+        return false;
+    }
+
+    // 重新录入时旧版 YAML 文件一并删除，避免下次启动时迁移回旧模板
+    if (!keepExisting)
+    {
+        const QString legacyPath = QDir(directory).filePath(usernum + ".yml");
+        if (QFile::exists(legacyPath) && !QFile::remove(legacyPath))
+        {
+            qWarning() << "删除旧版人脸特征文件失败:" << legacyPath;
+        }
+    }
+
+    cacheUpdate(usernum, updated);
+    {
+        QWriteLocker indexLocker(&indexLock);
+        enrolled.insert(usernum);
+    }
+    {
+        QWriteLocker pinLocker(&pinLock);
+        auto it = pinned.find(usernum);
+        if (it != pinned.end())
+        {
+            it->templates = updated;
+        }
+    }
+
+    // 丢弃了旧模板时只标记索引中对应的旧节点，索引与文件保持一致
+    FaceIndex& index = FaceIndex::getInstance();
+    if (!keepExisting)
+    {
+        index.remove(usernum);
+    }
+    index.add(usernum, row.ptr<float>(), row.cols);
+    if (evicted)
+    {
+        index.trim(usernum, updated->count);
+    }
+    return true;
+}
+
+bool FaceEmbeddingStore::remove(const QString& usernum)
+{
+    QMutexLocker locker(&writeMutex);
+
+    // 旧版 YAML 文件一并删除，避免下次启动重新迁移
+    const QString legacyPath = QDir(directory).filePath(usernum + ".yml");
+    for (const QString& path : {pathFor(usernum), legacyPath})
+    {
+        if (QFile::exists(path) && !QFile::remove(path))
+        {
+            qWarning() << "删除人脸特征文件失败:" << path;
+            return false;
+        }
+    }
+
+    cacheUpdate(usernum, nullptr);
+    {
+        QWriteLocker indexLocker(&indexLock);
+        enrolled.remove(usernum);
+    }
+    {
+        QWriteLocker pinLocker(&pinLock);
+        auto it = pinned.find(usernum);
+        if (it != pinned.end())
+        {
+            it->templates.reset();
+        }
+    }
+    FaceIndex::getInstance().remove(usernum);
+    return true;
+}
+
+bool FaceEmbeddingStore::compact()
+{
+    QDir dir(directory);
+    if (!dir.exists())
+    {
+        qWarning() << "人脸特征目录不存在:" << directory;
+        return false;
+    }
+
+    QMutexLocker locker(&writeMutex);
+
+    int rewritten = 0;
+    int dropped = 0;
+    bool ok = true;
+    QSet<QString> users;
+
+    const QFileInfoList binaries = dir.entryInfoList({"*.emb"}, QDir::Files);
+    for (const QFileInfo& info : binaries)
+    {
+        users.insert(info.completeBaseName());
+
+        quint32 version = 0;
+        std::shared_ptr<const FaceTemplates> stored = readFile(info.filePath(), &version);
+        if (!stored)
+        {
+            ok = false;
+            continue;
+        }
+        if (version == EMB_VERSION && stored->count <= maxTemplates)
+        {
+            continue;
+        }
+
+        // 质心已由全部模板算出，再丢弃多余的旧模板
+        FaceTemplates compacted = *stored;
+        const int before = compacted.count;
+        capTemplates(compacted, maxTemplates);
+        if (!writeFile(info.filePath(), compacted))
+        {
+            ok = false;
+            continue;
+        }
+        ++rewritten;
+        dropped += before - compacted.count;
+    }
+
+    // 尚未迁移的 YAML 文件迁移时同样压缩
+    int migrated = 0;
+    const QFileInfoList yamls = dir.entryInfoList({"*.yml"}, QDir::Files);
+    for (const QFileInfo& info : yamls)
+    {
+        if (!users.contains(info.completeBaseName()) && migrateYaml(info.filePath(), info.completeBaseName()))
+        {
+            ++migrated;
+        }
+    }
+
+    qDebug() << "人脸特征压缩完成，改写文件:" << rewritten << "丢弃模板:" << dropped << "迁移 YAML:" << migrated
+             << "每人模板上限:" << maxTemplates;
+    return ok;
+}
+
+int FaceEmbeddingStore::pin(const QString& group, const QStringList& usernums)
+{
+    // 读盘时不持有任何锁，不阻塞比对与录入；已在常驻集合中的用户不重复读取。
+    // 与 templates() 一样先记下版本号，读取期间被保存或删除过的用户不使用读到的模板
+    struct Loaded
+    {
+        std::shared_ptr<const FaceTemplates> templates;
+        quint64 version;
+    };
+    QHash<QString, Loaded> loaded;
+    for (const QString& usernum : usernums)
+    {
+        if (loaded.contains(usernum) || !has(usernum))
+        {
+            continue;
+        }
+        {
+            QReadLocker locker(&pinLock);
+            auto it = pinned.constFind(usernum);
+            if (it != pinned.constEnd() && it->templates)
+            {
+                continue;
+            }
+        }
+        quint64 version = 0;
+        {
+            QMutexLocker locker(&cacheMutex);
+            version = versions.value(usernum);
+        }
+        if (std::shared_ptr<const FaceTemplates> stored = readFile(pathFor(usernum)))
+        {
+            loaded.insert(usernum, Loaded{stored, version});
+        }
+    }
+
+    // 只在登记时与保存、删除串行，此时没有写入在进行，版本号一致即说明读到的是最新模板
+    QMutexLocker writeLocker(&writeMutex);
+    QWriteLocker locker(&pinLock);
+    QMutexLocker versionLocker(&cacheMutex);
+    int installed = 0;
+    QSet<QString>& members = pinGroups[group];
+    for (const QString& usernum : usernums)
+    {
+        if (members.contains(usernum))
+        {
+            continue;
+        }
+        members.insert(usernum);
+
+        PinnedEntry& entry = pinned[usernum];
+        ++entry.groups;
+        auto it = loaded.constFind(usernum);
+        if (entry.templates || it == loaded.constEnd())
+        {
+            continue;
+        }
+        if (versions.value(usernum) == it->version)
+        {
+            entry.templates = it->templates;
+            ++installed;
+        }
+        else if (auto* cached = cache.object(usernum))
+        {
+            // 读取期间重新保存过，保存时写入了缓存，用缓存中的新模板
+            entry.templates = *cached;
+            ++installed;
+        }
+    }
+
+    qDebug() << "常驻人脸特征:" << group << "用户" << members.size() << "本次读取" << loaded.size() << "登记" << installed;
+    return installed;
+}
+
+void FaceEmbeddingStore::unpin(const QString& group)
+{
+    QWriteLocker locker(&pinLock);
+
+    auto groupIt = pinGroups.find(group);
+    if (groupIt == pinGroups.end())
+    {
+        return;
+    }
+
+    for (const QString& usernum : std::as_const(groupIt.value()))
+    {
+        auto it = pinned.find(usernum);
+        if (it != pinned.end() && --it->groups <= 0)
+        {
+            pinned.erase(it);
+        }
+    }
+    pinGroups.erase(groupIt);
+
+    qDebug() << "释放常驻人脸特征:" << group << "剩余用户" << pinned.size();
+}
+
+bool FaceEmbeddingStore::isPinned(const QString& group) const
+{
+    QReadLocker locker(&pinLock);
+    return pinGroups.contains(group);
+}
+
+FaceEmbeddingStore::Stats FaceEmbeddingStore::stats() const
+{
+    Stats result;
+    result.pinnedHits = pinnedHits.load(std::memory_order_relaxed);
+    result.cacheHits = cacheHits.load(std::memory_order_relaxed);
+    result.misses = misses.load(std::memory_order_relaxed);
+    {
+        QReadLocker locker(&pinLock);
+        result.pinnedUsers = pinned.size();
+    }
+    return result;
+}
+
+QString FaceEmbeddingStore::pathFor(const QString& usernum) const
+{
+    return QDir(directory).filePath(usernum + ".emb");
+}
+
+int FaceEmbeddingStore::userCount() const
+{
+    QReadLocker locker(&indexLock);
+    return enrolled.size();
+}
+
+std::shared_ptr<const FaceTemplates> FaceEmbeddingStore::readFile(const QString& path, quint32* version) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < EMB_HEADER_SIZE_V1)
+    {
+        qWarning() << "无法读取人脸特征文件:" << path;
+        return nullptr;
+    }
+
+    const qint64 size = file.size();
+    const uchar* mapped = file.map(0, size);
+    if (!mapped)
+    {
+        qWarning() << "映射人脸特征文件失败:" << path;
+        return nullptr;
+    }
+
+    const quint32 fileVersion = qFromLittleEndian<quint32>(mapped + 4);
+    const quint32 dim = qFromLittleEndian<quint32>(mapped + 8);
+    const quint32 count = qFromLittleEndian<quint32>(mapped + 12);
+    const bool current = fileVersion == EMB_VERSION && size >= EMB_HEADER_SIZE;
+
+    // 版本 2 起在模板前多存一行（样本之和或旧的质心）
+    const bool withHeader = (current || fileVersion == EMB_VERSION_V2) && size >= EMB_HEADER_SIZE;
+    const int headerSize = withHeader ? EMB_HEADER_SIZE : EMB_HEADER_SIZE_V1;
+    const quint32 rows = withHeader ? count + 1 : count;
+    const qint64 expected = headerSize + qint64(dim) * rows * qint64(sizeof(float));
+    if (std::memcmp(mapped, EMB_MAGIC, 4) != 0 || (!withHeader && fileVersion != EMB_VERSION_V1) || dim == 0 ||
+        size != expected)
+    {
+        qWarning() << "人脸特征文件格式错误:" << path;
+        file.unmap(const_cast<uchar*>(mapped));
+        return nullptr;
+    }
+
+    auto templates = std::make_shared<FaceTemplates>();
+    templates->dim = int(dim);
+    templates->count = int(count);
+    templates->data.resize(size_t(dim) * count);
+
+    const uchar* payload = mapped + headerSize;
+    if (current)
+    {
+        templates->samples = int(qFromLittleEndian<quint32>(mapped + 16));
+        templates->sum.resize(dim);
+        std::memcpy(templates->sum.data(), payload, dim * sizeof(float));
+    }
+    if (withHeader)
+    {
+        payload += dim * sizeof(float);
+    }
+    std::memcpy(templates->data.data(), payload, templates->data.size() * sizeof(float));
+
+    file.unmap(const_cast<uchar*>(mapped));
+
+    if (current)
+    {
+        templates->centroid = normalized(templates->sum);
+    }
+    else
+    {
+        rebuildCentroid(*templates);
+    }
+    if (version)
+    {
+        *version = fileVersion;
+    }
+    return templates;
+}
+
+bool FaceEmbeddingStore::writeFile(const QString& path, const FaceTemplates& templates) const
+{
+    uchar header[EMB_HEADER_SIZE];
+    std::memcpy(header, EMB_MAGIC, 4);
+    qToLittleEndian<quint32>(EMB_VERSION, header + 4);
+    qToLittleEndian<quint32>(quint32(templates.dim), header + 8);
+    qToLittleEndian<quint32>(quint32(templates.count), header + 12);
+    qToLittleEndian<quint32>(quint32(templates.samples), header + 16);
+
+    // 先写临时文件再替换，写入中途失败不会破坏原文件
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "无法写入人脸特征文件:" << path;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(header), EMB_HEADER_SIZE);
+    file.write(reinterpret_cast<const char*>(templates.sum.data()), qint64(templates.dim * sizeof(float)));
+    file.write(reinterpret_cast<const char*>(templates.data.data()), qint64(templates.data.size() * sizeof(float)));
+    if (!file.commit())
+    {
+        qWarning() << "保存人脸特征文件失败:" << path << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool FaceEmbeddingStore::migrateYaml(const QString& yamlPath, const QString& usernum)
+{
+    FaceTemplates templates;
+
+    try
+    {
+        cv::FileStorage fs(yamlPath.toStdString(), cv::FileStorage::READ);
+        if (!fs.isOpened())
+        {
+            qWarning() << "无法打开旧版人脸特征文件:" << yamlPath;
+            return false;
+        }
+
+        cv::FileNode rootNode = fs.root();
+        for (cv::FileNodeIterator it = rootNode.begin(); it != rootNode.end(); ++it)
+        {
+            if ((*it).name().find("feature_") != 0)
+            {
+                continue;
+            }
+
+            cv::Mat storedFeature;
+            (*it) >> storedFeature;
+            if (storedFeature.empty())
+            {
+                continue;
+            }
+
+            const cv::Mat row = normalizedRow(storedFeature);
+            if (templates.dim != 0 && templates.dim != row.cols)
+            {
+                qWarning() << "特征维度不一致，跳过:" << yamlPath << QString::fromStdString((*it).name());
+                continue;
+            }
+            templates.dim = row.cols;
+            templates.data.insert(templates.data.end(), row.ptr<float>(), row.ptr<float>() + row.cols);
+            ++templates.count;
+        }
+    }
+    catch (const cv::Exception& e)
+    {
+        qWarning() << "解析旧版人脸特征文件失败:" << yamlPath << QString::fromStdString(e.what());
+        return false;
+    }
+
+    if (templates.count == 0)
+    {
+        return false;
+    }
+
+    // 质心包含全部旧特征，模板只保留最近的 K 个
+    rebuildCentroid(templates);
+    capTemplates(templates, maxTemplates);
+    return writeFile(pathFor(usernum), templates);
+}
+
+void FaceEmbeddingStore::cacheInsert(const QString& usernum, const std::shared_ptr<const FaceTemplates>& templates, quint64 readVersion)
+{
+    QMutexLocker locker(&cacheMutex);
+    if (versions.value(usernum) != readVersion)
+    {
+        return;
+    }
+    cache.insert(usernum, new std::shared_ptr<const FaceTemplates>(templates), cacheCost(*templates));
+}
+
+void FaceEmbeddingStore::cacheUpdate(const QString& usernum, const std::shared_ptr<const FaceTemplates>& templates)
+{
+    QMutexLocker locker(&cacheMutex);
+    ++versions[usernum];
+    if (templates)
+    {
+        cache.insert(usernum, new std::shared_ptr<const FaceTemplates>(templates), cacheCost(*templates));
+    }
+    else
+    {
+        cache.remove(usernum);
+    }
+}
+
+qsizetype FaceEmbeddingStore::cacheCost(const FaceTemplates& templates)
+{
+    return qMax<qsizetype>(1, qsizetype((templates.data.size() + templates.sum.size() + templates.centroid.size()) * sizeof(float)));
+}
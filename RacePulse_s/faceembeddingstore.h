@@ -0,0 +1,119 @@
+#ifndef FACEEMBEDDINGSTORE_H
+#define FACEEMBEDDINGSTORE_H
+
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QSettings>
+#include <QString>
+#include <QStringList>
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// 一个用户的人脸模板，已做 L2 归一化的 float32，按行连续存放
+// 最多保留最近的 K 个模板，质心由全部录入过的样本之和归一化得到
+struct FaceTemplates
+{
+    int dim = 0;
+    int count = 0;
+    int samples = 0;             // 累计录入的样本数，可能大于 count
+    std::vector<float> sum;      // dim，全部样本之和，未归一化，持久化保存
+    std::vector<float> centroid; // dim，sum 归一化后的结果，只在内存中
+    std::vector<float> data;     // count * dim
+
+    const float* row(int i) const { return data.data() + size_t(i) * dim; }
+};
+
+// 人脸特征库
+// 每个用户一个二进制文件 <dir>/<usernum>.emb：20 字节文件头 + 样本之和 + count * dim 个 float32，
+// 写入前已归一化，比对时不再转换类型与归一化；
+// 读取时映射文件后拷入内存，按 LRU 缓存；是否已绑定人脸只查内存中的集合，O(1)
+class FaceEmbeddingStore
+{
+private:
+    FaceEmbeddingStore();
+    FaceEmbeddingStore(const FaceEmbeddingStore&) = delete;            // 删除复制构造函数
+    FaceEmbeddingStore& operator=(const FaceEmbeddingStore&) = delete; // 删除赋值操作符
+    ~FaceEmbeddingStore();
+
+public:
+    static FaceEmbeddingStore& getInstance();
+
+    // 扫描特征目录，旧的 YAML 特征文件一次性迁移为二进制格式
+    bool open();
+
+    bool has(const QString& usernum) const;
+    std::shared_ptr<const FaceTemplates> templates(const QString& usernum);
+
+    // 新模板加入后超过上限时丢弃最旧的模板，质心按全部样本更新
+    bool append(const QString& usernum, const cv::Mat& feature);
+    // 用一个新模板替换该用户的全部模板（重新录入），写入成功前原模板不受影响
+    bool replace(const QString& usernum, const cv::Mat& feature);
+    bool remove(const QString& usernum);
+
+    // 离线压缩：旧格式与超过模板上限的文件改写为带质心的新格式，服务运行时不要调用
+    bool compact();
+
+    // 常驻集合：按分组（赛事）预先读入一批用户的模板，不受 LRU 淘汰，
+    // 同一用户可属于多个分组，全部分组释放后才移出
+    int pin(const QString& group, const QStringList& usernums);
+    void unpin(const QString& group);
+    bool isPinned(const QString& group) const;
+
+    struct Stats
+    {
+        quint64 pinnedHits; // 命中常驻集合
+        quint64 cacheHits;  // 命中 LRU 缓存
+        quint64 misses;     // 读取磁盘
+        int pinnedUsers;
+    };
+    Stats stats() const;
+
+    QString pathFor(const QString& usernum) const;
+    int userCount() const;
+
+private:
+    bool store(const QString& usernum, const cv::Mat& feature, bool keepExisting);
+    std::shared_ptr<const FaceTemplates> readFile(const QString& path, quint32* version = nullptr) const;
+    bool writeFile(const QString& path, const FaceTemplates& templates) const;
+    bool migrateYaml(const QString& yamlPath, const QString& usernum);
+    // 读盘得到的模板只在读取期间没有被保存或删除时放入缓存
+    void cacheInsert(const QString& usernum, const std::shared_ptr<const FaceTemplates>& templates, quint64 readVersion);
+    void cacheUpdate(const QString& usernum, const std::shared_ptr<const FaceTemplates>& templates); // 保存或删除（为空）后调用
+    static qsizetype cacheCost(const FaceTemplates& templates);
+
+private:
+    // 使用配置文件
+    QString directory = QSettings().value("face/directory", "./faces").toString();
+    qint64 cacheBytes = QSettings().value("face/cache_mb", 256).toLongLong() * 1024 * 1024;
+    int maxTemplates = qMax(1, QSettings().value("face/max_templates", 5).toInt()); // 每个用户保留的模板数 K
+
+    mutable QReadWriteLock indexLock; // 保护 enrolled
+    QSet<QString> enrolled;           // 已有特征的用户
+
+    QMutex cacheMutex; // QCache 非线程安全，同时保护 versions
+    QCache<QString, std::shared_ptr<const FaceTemplates>> cache;
+    QHash<QString, quint64> versions; // 每次保存或删除加一
+
+    QMutex writeMutex; // 串行化文件写入
+
+    struct PinnedEntry
+    {
+        std::shared_ptr<const FaceTemplates> templates;
+        int groups = 0; // 引用该用户的分组数
+    };
+    mutable QReadWriteLock pinLock; // 保护 pinGroups 与 pinned
+    QHash<QString, QSet<QString>> pinGroups;
+    QHash<QString, PinnedEntry> pinned;
+
+    std::atomic<quint64> pinnedHits{0};
+    std::atomic<quint64> cacheHits{0};
+    std::atomic<quint64> misses{0};
+};
+
+#endif // FACEEMBEDDINGSTORE_H
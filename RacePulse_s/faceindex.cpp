@@ -0,0 +1,442 @@
+#include "faceindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+#include "facesimilarity.h"
+#include "qdebug.h"
+
+namespace
+{
+// 每个搜索线程一份访问标记，按轮次区分，避免每次搜索清零
+struct VisitedSet
+{
+    std::vector<unsigned> marks;
+    unsigned epoch = 0;
+
+    void reset(size_t size)
+    {
+        if (marks.size() < size)
+        {
+            marks.resize(size, 0);
+        }
+        if (++epoch == 0)
+        {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    bool visit(int node)
+    {
+        if (marks[node] == epoch)
+        {
+            return false;
+        }
+        marks[node] = epoch;
+        return true;
+    }
+};
+
+VisitedSet& visitedSet()
+{
+    thread_local VisitedSet visited;
+    return visited;
+}
+} // namespace
+
+FaceIndex& FaceIndex::getInstance()
+{
+    static FaceIndex instance;
+    return instance;
+}
+
+FaceIndex::FaceIndex()
+{
+    M = qMax(2, M);
+    efConstruction = qMax(M, efConstruction);
+    efSearch = qMax(1, efSearch);
+    levelFactor = 1.0 / std::log(double(M));
+}
+
+FaceIndex::~FaceIndex()
+{
+}
+
+void FaceIndex::add(const QString& usernum, const float* vector, int vectorDim)
+{
+    QWriteLocker locker(&lock);
+
+    if (dim == 0)
+    {
+        dim = vectorDim;
+    }
+    if (vectorDim != dim)
+    {
+        qWarning() << "特征维度与索引不一致，忽略:" << usernum << vectorDim << dim;
+        return;
+    }
+
+    int userId = userIds.value(usernum, -1);
+    if (userId < 0)
+    {
+        userId = int(userNames.size());
+        userIds.insert(usernum, userId);
+        userNames.push_back(usernum);
+        userNodes.emplace_back();
+    }
+    insert(userId, vector);
+}
+
+void FaceIndex::remove(const QString& usernum)
+{
+    QWriteLocker locker(&lock);
+
+    auto it = userIds.find(usernum);
+    if (it == userIds.end())
+    {
+        return;
+    }
+    std::vector<int>& nodes = userNodes[it.value()];
+    for (int node : nodes)
+    {
+        markRemoved(node);
+    }
+    nodes.clear();
+    userIds.erase(it);
+    rebuildIfSparse();
+}
+
+void FaceIndex::trim(const QString& usernum, int keep)
+{
+    QWriteLocker locker(&lock);
+
+    auto it = userIds.constFind(usernum);
+    if (it == userIds.constEnd())
+    {
+        return;
+    }
+    std::vector<int>& nodes = userNodes[it.value()];
+    if (int(nodes.size()) <= keep)
+    {
+        return;
+    }
+    const size_t dropped = nodes.size() - size_t(qMax(0, keep));
+    for (size_t i = 0; i < dropped; ++i)
+    {
+        markRemoved(nodes[i]);
+    }
+    nodes.erase(nodes.begin(), nodes.begin() + dropped);
+    rebuildIfSparse();
+}
+
+void FaceIndex::clear()
+{
+    QWriteLocker locker(&lock);
+
+    dim = 0;
+    entryPoint = -1;
+    maxLevel = -1;
+    vectors.clear();
+    owners.clear();
+    removed.clear();
+    links.clear();
+    removedCount = 0;
+    userIds.clear();
+    userNames.clear();
+    userNodes.clear();
+}
+
+void FaceIndex::insert(int userId, const float* vector)
+{
+    const int node = int(owners.size());
+    const int level = randomLevel();
+    vectors.insert(vectors.end(), vector, vector + dim);
+    owners.push_back(userId);
+    removed.push_back(0);
+    links.emplace_back(level + 1);
+    userNodes[userId].push_back(node);
+
+    if (entryPoint < 0)
+    {
+        entryPoint = node;
+        maxLevel = level;
+        return;
+    }
+
+    const float* query = vectorOf(node);
+
+    // 高层只做贪心下降，找到插入层的入口
+    int entry = entryPoint;
+    for (int l = maxLevel; l > level; --l)
+    {
+        entry = greedyClosest(query, entry, l);
+    }
+
+    for (int l = std::min(level, maxLevel); l >= 0; --l)
+    {
+        std::vector<Candidate> candidates = searchLayer(query, entry, efConstruction, l);
+        const int maxCount = (l == 0) ? 2 * M : M;
+
+        links[node][l] = selectNeighbors(candidates, maxCount);
+        for (int neighbor : links[node][l])
+        {
+            connect(neighbor, node, l);
+        }
+        entry = candidates.front().second;
+    }
+
+    if (level > maxLevel)
+    {
+        entryPoint = node;
+        maxLevel = level;
+    }
+}
+
+void FaceIndex::markRemoved(int node)
+{
+    if (!removed[node])
+    {
+        removed[node] = 1;
+        ++removedCount;
+    }
+}
+
+void FaceIndex::rebuildIfSparse()
+{
+    // 节点很少时重建的意义不大，留到下次启动
+    if (removedCount < 1024 || removedCount < rebuildRatio * owners.size())
+    {
+        return;
+    }
+
+    // 按原插入顺序重新插入剩余节点，每个用户的节点顺序不变
+    std::vector<std::pair<int, int>> live; // 用户 id, 节点
+    live.reserve(owners.size() - size_t(removedCount));
+    for (int node = 0; node < int(owners.size()); ++node)
+    {
+        if (!removed[node])
+        {
+            live.emplace_back(owners[node], node);
+        }
+    }
+    const std::vector<float> oldVectors = std::move(vectors);
+    const int before = int(owners.size());
+
+    entryPoint = -1;
+    maxLevel = -1;
+    vectors.clear();
+    owners.clear();
+    removed.clear();
+    links.clear();
+    removedCount = 0;
+    for (std::vector<int>& nodes : userNodes)
+    {
+        nodes.clear();
+    }
+
+    vectors.reserve(live.size() * size_t(dim));
+    for (const std::pair<int, int>& entry : live)
+    {
+        insert(entry.first, oldVectors.data() + size_t(entry.second) * dim);
+    }
+    qDebug() << "人脸索引重建，节点:" << before << "->" << owners.size();
+}
+
+QList<FaceIndex::Result> FaceIndex::search(const float* probe, int probeDim, int k) const
+{
+    QReadLocker locker(&lock);
+
+    QList<Result> results;
+    if (entryPoint < 0 || probeDim != dim || k <= 0)
+    {
+        return results;
+    }
+
+    int entry = entryPoint;
+    for (int l = maxLevel; l > 0; --l)
+    {
+        entry = greedyClosest(probe, entry, l);
+    }
+
+    // 已删除的节点照常参与图上的遍历，只是不进入结果
+    std::vector<Candidate> candidates = searchLayer(probe, entry, std::max(efSearch, k), 0);
+
+    // 结果最多 k 个用户，查重只看已选出的，不按总用户数分配标记
+    std::vector<int> seen;
+    seen.reserve(k);
+    for (const Candidate& candidate : candidates)
+    {
+        if (removed[candidate.second])
+        {
+            continue;
+        }
+        const int userId = owners[candidate.second];
+        if (std::find(seen.begin(), seen.end(), userId) != seen.end())
+        {
+            continue;
+        }
+        seen.push_back(userId);
+        results.append(Result{userNames[userId], candidate.first});
+        if (results.size() >= k)
+        {
+            break;
+        }
+    }
+    return results;
+}
+
+int FaceIndex::size() const
+{
+    QReadLocker locker(&lock);
+    return int(owners.size());
+}
+
+int FaceIndex::userCount() const
+{
+    QReadLocker locker(&lock);
+    return userIds.size();
+}
+
+const float* FaceIndex::vectorOf(int node) const
+{
+    return vectors.data() + size_t(node) * dim;
+}
+
+float FaceIndex::distance(const float* a, int node) const
+{
+    return 1.0f - FaceSimilarity::dot(a, vectorOf(node), dim);
+}
+
+int FaceIndex::randomLevel()
+{
+    std::uniform_real_distribution<double> uniform(std::nextafter(0.0, 1.0), 1.0);
+    return int(-std::log(uniform(rng)) * levelFactor);
+}
+
+int FaceIndex::greedyClosest(const float* query, int entry, int level) const
+{
+    int current = entry;
+    float currentDistance = distance(query, current);
+
+    bool improved = true;
+    while (improved)
+    {
+        improved = false;
+        for (int neighbor : links[current][level])
+        {
+            const float d = distance(query, neighbor);
+            if (d < currentDistance)
+            {
+                currentDistance = d;
+                current = neighbor;
+                improved = true;
+            }
+        }
+    }
+    return current;
+}
+
+std::vector<FaceIndex::Candidate> FaceIndex::searchLayer(const float* query, int entry, int ef, int level) const
+{
+    VisitedSet& visited = visitedSet();
+    visited.reset(owners.size());
+
+    // candidates 按距离从小到大出队，nearest 保留当前最近的 ef 个（堆顶为其中最远的）
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    std::priority_queue<Candidate> nearest;
+
+    const float entryDistance = distance(query, entry);
+    visited.visit(entry);
+    candidates.emplace(entryDistance, entry);
+    nearest.emplace(entryDistance, entry);
+
+    while (!candidates.empty())
+    {
+        const Candidate current = candidates.top();
+        if (current.first > nearest.top().first && int(nearest.size()) >= ef)
+        {
+            break;
+        }
+        candidates.pop();
+
+        for (int neighbor : links[current.second][level])
+        {
+            if (!visited.visit(neighbor))
+            {
+                continue;
+            }
+
+            const float d = distance(query, neighbor);
+            if (int(nearest.size()) < ef || d < nearest.top().first)
+            {
+                candidates.emplace(d, neighbor);
+                nearest.emplace(d, neighbor);
+                if (int(nearest.size()) > ef)
+                {
+                    nearest.pop();
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> result(nearest.size());
+    for (size_t i = result.size(); i > 0; --i)
+    {
+        result[i - 1] = nearest.top();
+        nearest.pop();
+    }
+    return result;
+}
+
+std::vector<int> FaceIndex::selectNeighbors(const std::vector<Candidate>& candidates, int maxCount) const
+{
+    // 启发式选邻：候选点离查询点比离已选邻居都近才保留，让邻居分布在不同方向
+    std::vector<int> selected;
+    selected.reserve(maxCount);
+    for (const Candidate& candidate : candidates)
+    {
+        if (int(selected.size()) >= maxCount)
+        {
+            break;
+        }
+
+        bool keep = true;
+        for (int chosen : selected)
+        {
+            if (distance(vectorOf(candidate.second), chosen) < candidate.first)
+            {
+                keep = false;
+                break;
+            }
+        }
+        if (keep)
+        {
+            selected.push_back(candidate.second);
+        }
+    }
+    return selected;
+}
+
+void FaceIndex::connect(int node, int neighbor, int level)
+{
+    std::vector<int>& neighbors = links[node][level];
+    neighbors.push_back(neighbor);
+
+    const int maxCount = (level == 0) ? 2 * M : M;
+    if (int(neighbors.size()) <= maxCount)
+    {
+        return;
+    }
+
+    // 超出上限时按同样的启发式重新挑选
+    std::vector<Candidate> candidates;
+    candidates.reserve(neighbors.size());
+    for (int n : neighbors)
+    {
+        candidates.emplace_back(distance(vectorOf(node), n), n);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    neighbors = selectNeighbors(candidates, maxCount);
+}
@@ -0,0 +1,88 @@
+#ifndef FACEINDEX_H
+#define FACEINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QReadWriteLock>
+#include <QSettings>
+#include <QString>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+// 1:N 人脸识别用的近似最近邻索引（HNSW）
+// 每个模板一个节点，距离为余弦距离（向量已 L2 归一化）；
+// 特征库保存新模板时增量插入，删除用户或淘汰旧模板只标记对应节点，搜索时跳过，
+// 已删除节点超过一定比例时用剩余节点重建图
+// 插入取写锁，搜索取读锁，可以多个线程同时搜索
+class FaceIndex
+{
+private:
+    FaceIndex();
+    FaceIndex(const FaceIndex&) = delete;            // 删除复制构造函数
+    FaceIndex& operator=(const FaceIndex&) = delete; // 删除赋值操作符
+    ~FaceIndex();
+
+public:
+    struct Result
+    {
+        QString usernum;
+        float distance;
+    };
+
+    static FaceIndex& getInstance();
+
+    void add(const QString& usernum, const float* vector, int dim);
+    void remove(const QString& usernum);
+    void trim(const QString& usernum, int keep); // 只保留该用户最近插入的 keep 个节点，与特征库的模板上限一致
+    void clear();
+
+    // 返回距离最近的 k 个用户（同一用户只保留最近的模板），按距离升序
+    QList<Result> search(const float* probe, int dim, int k) const;
+
+    int size() const;      // 节点数，包含已删除的
+    int userCount() const; // 有效用户数
+
+private:
+    using Candidate = std::pair<float, int>; // 距离, 节点
+
+    void insert(int userId, const float* vector);
+    void markRemoved(int node);
+    void rebuildIfSparse(); // 已删除节点过多时重建，调用方持有写锁
+
+    float distance(const float* a, int node) const;
+    const float* vectorOf(int node) const;
+    int randomLevel();
+    int greedyClosest(const float* query, int entry, int level) const;
+    std::vector<Candidate> searchLayer(const float* query, int entry, int ef, int level) const;
+    std::vector<int> selectNeighbors(const std::vector<Candidate>& candidates, int maxCount) const;
+    void connect(int node, int neighbor, int level);
+
+private:
+    // 使用配置文件
+    int M = QSettings().value("face/hnsw_m", 16).toInt();                             // 每层最大邻居数，第 0 层为 2M
+    int efConstruction = QSettings().value("face/hnsw_ef_construction", 100).toInt(); // 插入时的候选集大小
+    int efSearch = QSettings().value("face/hnsw_ef_search", 64).toInt();              // 搜索时的候选集大小
+    double rebuildRatio = QSettings().value("face/hnsw_rebuild_ratio", 0.25).toDouble(); // 已删除节点占比超过该值时重建
+
+    mutable QReadWriteLock lock;
+
+    int dim = 0;
+    int entryPoint = -1;
+    int maxLevel = -1;
+    double levelFactor;
+    std::mt19937 rng{20240601};
+
+    std::vector<float> vectors;                   // 节点向量，按节点连续存放
+    std::vector<int> owners;                      // 节点 -> 用户 id
+    std::vector<char> removed;                    // 节点是否已删除
+    std::vector<std::vector<std::vector<int>>> links; // 节点 -> 层 -> 邻居
+    int removedCount = 0;
+
+    QHash<QString, int> userIds; // 有效用户 -> 用户 id，删除后重新登记会分配新 id
+    std::vector<QString> userNames;
+    std::vector<std::vector<int>> userNodes; // 用户 id -> 未删除的节点，按插入顺序
+};
+
+#endif // FACEINDEX_H
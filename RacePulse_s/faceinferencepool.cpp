@@ -0,0 +1,377 @@
+#include "faceinferencepool.h"
+
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+
+#include "facemetrics.h"
+#include "facemodelregistry.h"
+#include "qdebug.h"
+
+FaceInferencePool& FaceInferencePool::getInstance()
+{
+    static FaceInferencePool instance;
+    return instance;
+}
+
+FaceInferencePool::FaceInferencePool()
+{
+    threadCount = qMax(1, threadCount);
+    batchSize = qMax(1, batchSize);
+    batchWaitMs = qMax(0, batchWaitMs);
+    maxPending = qMax(batchSize, maxPending);
+}
+
+FaceInferencePool::~FaceInferencePool()
+{
+    stop();
+}
+
+void FaceInferencePool::start()
+{
+    QMutexLocker locker(&mutex);
+    if (running)
+    {
+        return;
+    }
+    running = true;
+    warmPending.assign(size_t(threadCount), 0);
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        QThread* thread = QThread::create([this, i]() { workerLoop(i); });
+        thread->setObjectName(QString("FaceInference_%1").arg(i));
+        workers.append(thread);
+        thread->start();
+    }
+
+    qDebug() << "人脸推理线程数:" << threadCount << "批大小:" << batchSize;
+}
+
+void FaceInferencePool::stop()
+{
+    QList<QThread*> stopping;
+    {
+        QMutexLocker locker(&mutex);
+        if (!running)
+        {
+            return;
+        }
+        running = false;
+        stopping.swap(workers);
+    }
+    jobAvailable.wakeAll();
+
+    // 推理线程退出前会处理完已排队的任务
+    for (QThread* thread : stopping)
+    {
+        thread->wait();
+    }
+    qDeleteAll(stopping);
+
+    // 未完成的预热不再回调
+    QMutexLocker locker(&mutex);
+    warmRemaining = 0;
+    warmDone = nullptr;
+}
+
+bool FaceInferencePool::warmUp(std::function<void()> done)
+{
+    {
+        QMutexLocker locker(&mutex);
+        if (!running || warmRemaining > 0)
+        {
+            return false;
+        }
+        std::fill(warmPending.begin(), warmPending.end(), 1);
+        warmRemaining = int(warmPending.size());
+        warmDone = std::move(done);
+    }
+    jobAvailable.wakeAll();
+    return true;
+}
+
+bool FaceInferencePool::submit(const cv::Mat& face, Callback done, CancelToken cancel)
+{
+    if (face.empty())
+    {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        if (!running || int(jobs.size()) >= maxPending)
+        {
+            return false;
+        }
+        jobs.push_back(Job{face, std::move(done), std::move(cancel)});
+    }
+    jobAvailable.wakeOne();
+    return true;
+}
+
+int FaceInferencePool::workerCount() const
+{
+    QMutexLocker locker(&mutex);
+    return workers.size();
+}
+
+int FaceInferencePool::pendingCount() const
+{
+    QMutexLocker locker(&mutex);
+    return int(jobs.size());
+}
+
+bool FaceInferencePool::setBatchSize(int size)
+{
+    QMutexLocker locker(&mutex);
+    if (running)
+    {
+        return false;
+    }
+    batchSize = qMax(1, size);
+    maxPending = qMax(batchSize, maxPending);
+    return true;
+}
+
+int FaceInferencePool::currentBatchSize() const
+{
+    QMutexLocker locker(&mutex);
+    return batchSize;
+}
+
+quint64 FaceInferencePool::fallbackCount() const
+{
+    return fallbacks.load(std::memory_order_relaxed);
+}
+
+void FaceInferencePool::workerLoop(int index)
+{
+    std::vector<Job> batch;
+    Workspace workspace; // 本线程复用的输入 blob 与缩放缓冲
+    bool warm = false;
+    while (takeBatch(index, batch, warm))
+    {
+        if (warm)
+        {
+            warmUpWorker(workspace);
+            finishWarmUp();
+            warm = false;
+            continue;
+        }
+        if (!batch.empty())
+        {
+            runBatch(batch, workspace);
+        }
+        batch.clear();
+    }
+}
+
+bool FaceInferencePool::takeBatch(int index, std::vector<Job>& batch, bool& warm)
+{
+    QMutexLocker locker(&mutex);
+
+    while (jobs.empty() && !warmPending[index])
+    {
+        if (!running)
+        {
+            return false;
+        }
+        jobAvailable.wait(&mutex);
+    }
+
+    // 预热优先于排队的任务，之后的任务都使用新模型
+    if (warmPending[index])
+    {
+        warmPending[index] = 0;
+        warm = true;
+        return true;
+    }
+
+    // 凑不满一批时再等一小段时间，让同时到达的请求合并为一次 forward
+    QDeadlineTimer deadline(batchWaitMs);
+    while (int(jobs.size()) < batchSize && running && !deadline.hasExpired())
+    {
+        if (!jobAvailable.wait(&mutex, deadline))
+        {
+            break;
+        }
+    }
+
+    // 已取消的任务（如流式验证已有一帧通过）直接丢弃，省下推理
+    while (int(batch.size()) < batchSize && !jobs.empty())
+    {
+        Job job = std::move(jobs.front());
+        jobs.pop_front();
+        if (job.cancel && job.cancel->load(std::memory_order_acquire))
+        {
+            FaceMetrics::getInstance().recordCancelled();
+            continue;
+        }
+        batch.push_back(std::move(job));
+    }
+
+    // 还有剩余任务时唤醒其它推理线程
+    if (!jobs.empty())
+    {
+        jobAvailable.wakeOne();
+    }
+    return true;
+}
+
+void FaceInferencePool::warmUpWorker(Workspace& workspace)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // 构建本线程的模型；有待切换的新版本时构建新版本，切换前请求仍使用旧实例
+    EmbeddingBackend* backend = FaceModelRegistry::getInstance().prepareEmbedding();
+    if (!backend)
+    {
+        return;
+    }
+
+    // 按最大批大小推理一次空白输入，让后端完成内存分配与图优化
+    const int blobSizes[] = {batchSize, 3, INPUT_SIZE, INPUT_SIZE};
+    workspace.blob.create(4, blobSizes, CV_32F);
+    workspace.blob.setTo(cv::Scalar::all(0));
+    std::vector<cv::Mat> features(size_t(batchSize));
+    try
+    {
+        backend->run(workspace.blob.ptr<float>(), batchSize, features.data());
+    }
+    catch (const std::exception&)
+    {
+        try
+        {
+            backend->run(workspace.blob.ptr<float>(), 1, features.data());
+        }
+        catch (const std::exception& e)
+        {
+            qDebug() << "Warm-up inference failed:" << e.what();
+        }
+    }
+
+    qDebug() << QThread::currentThread()->objectName() << "预热完成，模型版本"
+             << FaceModelRegistry::getInstance().generation() << "耗时" << timer.elapsed() << "ms";
+}
+
+void FaceInferencePool::finishWarmUp()
+{
+    std::function<void()> done;
+    {
+        QMutexLocker locker(&mutex);
+        if (warmRemaining <= 0 || --warmRemaining > 0)
+        {
+            return;
+        }
+        done = std::move(warmDone);
+        warmDone = nullptr;
+    }
+    if (done)
+    {
+        done();
+    }
+}
+
+void FaceInferencePool::runBatch(std::vector<Job>& batch, Workspace& workspace)
+{
+    std::vector<cv::Mat> features(batch.size());
+
+    EmbeddingBackend* backend = FaceModelRegistry::getInstance().embeddingBackend();
+    if (!backend)
+    {
+        qDebug() << "Failed to load network model";
+    }
+    else
+    {
+        // 输入 blob 按最大批大小分配一次，之后每批直接写入，不再分配
+        const int count = int(batch.size());
+        const int blobSizes[] = {batchSize, 3, INPUT_SIZE, INPUT_SIZE};
+        workspace.blob.create(4, blobSizes, CV_32F);
+        float* blobData = workspace.blob.ptr<float>();
+        for (int i = 0; i < count; ++i)
+        {
+            preprocess(batch[i].face, workspace.resized, blobData + size_t(i) * IMAGE_FLOATS);
+        }
+
+        try
+        {
+            backend->run(blobData, count, features.data());
+        }
+        catch (const std::exception& e)
+        {
+            // 模型不支持动态 batch 时退回逐张推理
+            qDebug() << "Batch forward failed, falling back to single images:" << e.what();
+            fallbacks.fetch_add(1, std::memory_order_relaxed);
+            for (int i = 0; i < count; ++i)
+            {
+                try
+                {
+                    backend->run(blobData + size_t(i) * IMAGE_FLOATS, 1, &features[i]);
+                }
+                catch (const std::exception& err)
+                {
+                    qDebug() << "Inference error:" << err.what();
+                }
+            }
+        }
+    }
+
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        if (batch[i].done)
+        {
+            batch[i].done(features[i]);
+        }
+    }
+}
+
+void FaceInferencePool::preprocess(const cv::Mat& face, cv::Mat& resized, float* dst)
+{
+    // 调用方通常已裁剪为 112x112，只有尺寸不符时才缩放，缓冲区由调用方复用
+    const cv::Mat* src = &face;
+    if (face.cols != INPUT_SIZE || face.rows != INPUT_SIZE)
+    {
+        cv::resize(face, resized, cv::Size(INPUT_SIZE, INPUT_SIZE));
+        src = &resized;
+    }
+
+    // 单次遍历完成 归一化到 [-1, 1]、BGR->RGB 与 HWC->CHW，直接写入 blob
+    const float scale = 2.0f / 255.0f;
+    const float shift = -1.0f;
+    const int channels = src->channels();
+    const int area = INPUT_SIZE * INPUT_SIZE;
+    float* r = dst;
+    float* g = dst + area;
+    float* b = dst + 2 * area;
+
+    for (int y = 0; y < INPUT_SIZE; ++y)
+    {
+        const uchar* row = src->ptr<uchar>(y);
+        const int offset = y * INPUT_SIZE;
+        if (channels == 1)
+        {
+            for (int x = 0; x < INPUT_SIZE; ++x)
+            {
+                const float v = row[x] * scale + shift;
+                r[offset + x] = v;
+                g[offset + x] = v;
+                b[offset + x] = v;
+            }
+        }
+        else
+        {
+            // BGR 或 BGRA，按通道数跨步，忽略 alpha
+            for (int x = 0; x < INPUT_SIZE; ++x)
+            {
+                const uchar* pixel = row + x * channels;
+                b[offset + x] = pixel[0] * scale + shift;
+                g[offset + x] = pixel[1] * scale + shift;
+                r[offset + x] = pixel[2] * scale + shift;
+            }
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef FACEINFERENCEPOOL_H
+#define FACEINFERENCEPOOL_H
+
+#include <QList>
+#include <QMutex>
+#include <QSettings>
+#include <QThread>
+#include <QWaitCondition>
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "embeddingbackend.h"
+
+// 人脸特征提取线程池
+// 连接线程只负责检测与裁剪，特征提取交给固定数量的推理线程；
+// 每个推理线程持有自己的推理后端实例，把排队的人脸攒成一批（最多 batchSize 张，
+// 或等待 batchWaitMs 毫秒）一次 forward，结果在推理线程中回调
+class FaceInferencePool
+{
+private:
+    FaceInferencePool();
+    FaceInferencePool(const FaceInferencePool&) = delete;            // 删除复制构造函数
+    FaceInferencePool& operator=(const FaceInferencePool&) = delete; // 删除赋值操作符
+    ~FaceInferencePool();
+
+public:
+    // 特征向量为 1x512 的 CV_32F，失败时为空
+    using Callback = std::function<void(const cv::Mat& feature)>;
+    // 取消标记，置位后尚未开始推理的任务直接丢弃，不再回调
+    using CancelToken = std::shared_ptr<const std::atomic<bool>>;
+
+    static FaceInferencePool& getInstance();
+
+    void start();
+    void stop();
+
+    // 每个推理线程构建当前版本的模型并用空白输入推理一次，全部完成后在最后一个完成的推理线程中回调；
+    // 启动时与模型热更新后调用，避免首个请求承担构建开销。已有预热在进行或未启动时返回 false
+    bool warmUp(std::function<void()> done);
+
+    // 提交一张 112x112 的 BGR 人脸，队列已满或未启动时返回 false
+    bool submit(const cv::Mat& face, Callback done, CancelToken cancel = CancelToken());
+
+    int workerCount() const;
+    int pendingCount() const;
+
+    // 只能在未启动时修改批大小，供性能测试比较不同批大小，返回是否生效
+    bool setBatchSize(int size);
+    int currentBatchSize() const;
+    quint64 fallbackCount() const; // 批量推理失败、退回逐张推理的批数
+
+    // 单次遍历完成缩放（尺寸不符时）、归一化、BGR->RGB 与 HWC->CHW，写入 dst 处的一张图
+    static void preprocess(const cv::Mat& face, cv::Mat& resized, float* dst);
+
+private:
+    struct Job
+    {
+        cv::Mat face;
+        Callback done;
+        CancelToken cancel;
+    };
+
+    // 每个推理线程一份，跨批次复用
+    struct Workspace
+    {
+        cv::Mat blob;    // batchSize x 3 x 112 x 112
+        cv::Mat resized; // 输入不是 112x112 时的缩放缓冲
+    };
+
+    void workerLoop(int index);
+    bool takeBatch(int index, std::vector<Job>& batch, bool& warm);
+    void warmUpWorker(Workspace& workspace);
+    void finishWarmUp();
+    void runBatch(std::vector<Job>& batch, Workspace& workspace);
+
+    static constexpr int INPUT_SIZE = EmbeddingBackend::INPUT_SIZE;
+    static constexpr int IMAGE_FLOATS = EmbeddingBackend::IMAGE_FLOATS;
+
+private:
+    // 使用配置文件
+    int threadCount = QSettings().value("face/inference_threads", 2).toInt();
+    int batchSize = QSettings().value("face/batch_size", 8).toInt();
+    int batchWaitMs = QSettings().value("face/batch_wait_ms", 5).toInt();
+    int maxPending = QSettings().value("face/max_pending", 256).toInt();
+
+    mutable QMutex mutex;
+    QWaitCondition jobAvailable;
+    std::deque<Job> jobs;
+    bool running = false;
+
+    QList<QThread*> workers;
+    std::atomic<quint64> fallbacks{0};
+
+    // 预热：每个推理线程一个待办标记，受 mutex 保护
+    std::vector<char> warmPending;
+    int warmRemaining = 0;
+    std::function<void()> warmDone;
+};
+
+#endif // FACEINFERENCEPOOL_H
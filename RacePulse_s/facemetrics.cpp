@@ -0,0 +1,116 @@
+#include "facemetrics.h"
+
+#include <QStringList>
+
+FaceMetrics& FaceMetrics::getInstance()
+{
+    static FaceMetrics instance;
+    return instance;
+}
+
+FaceMetrics::FaceMetrics()
+{
+}
+
+FaceMetrics::~FaceMetrics()
+{
+}
+
+void FaceMetrics::record(Stage stage, qint64 nsecs)
+{
+    StageStats& stats = stages[stage];
+    const quint64 value = quint64(qMax<qint64>(0, nsecs));
+
+    stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.totalNs.fetch_add(value, std::memory_order_relaxed);
+
+    quint64 currentMax = stats.maxNs.load(std::memory_order_relaxed);
+    while (value > currentMax && !stats.maxNs.compare_exchange_weak(currentMax, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void FaceMetrics::recordRejected(FaceQuality::Issue issue)
+{
+    if (issue > FaceQuality::None && issue < FaceQuality::IssueCount)
+    {
+        rejected[issue].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void FaceMetrics::recordCancelled()
+{
+    cancelled.fetch_add(1, std::memory_order_relaxed);
+}
+
+quint64 FaceMetrics::inferencesAvoided() const
+{
+    quint64 total = cancelled.load(std::memory_order_relaxed);
+    for (int i = FaceQuality::None + 1; i < FaceQuality::IssueCount; ++i)
+    {
+        total += rejected[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+QString FaceMetrics::summary() const
+{
+    QStringList parts;
+    for (int i = 0; i < StageCount; ++i)
+    {
+        const StageStats& stats = stages[i];
+        const quint64 count = stats.count.load(std::memory_order_relaxed);
+        const double avgMs = count ? stats.totalNs.load(std::memory_order_relaxed) / 1e6 / count : 0.0;
+        const double maxMs = stats.maxNs.load(std::memory_order_relaxed) / 1e6;
+        parts << QString("%1 次数=%2 平均=%3ms 最大=%4ms")
+                     .arg(stageName(Stage(i)))
+                     .arg(count)
+                     .arg(avgMs, 0, 'f', 2)
+                     .arg(maxMs, 0, 'f', 2);
+    }
+
+    // 质量检查拦截与取消的排队任务，每次都省下一次特征提取
+    QStringList rejections;
+    for (int i = FaceQuality::None + 1; i < FaceQuality::IssueCount; ++i)
+    {
+        rejections << QString("%1=%2").arg(issueName(FaceQuality::Issue(i))).arg(rejected[i].load(std::memory_order_relaxed));
+    }
+    rejections << QString("取消=%1").arg(cancelled.load(std::memory_order_relaxed));
+    parts << QString("避免推理=%1 (%2)").arg(inferencesAvoided()).arg(rejections.join(" "));
+
+    return parts.join("; ");
+}
+
+const char* FaceMetrics::stageName(Stage stage)
+{
+    switch (stage)
+    {
+    case Decode:
+        return "解码";
+    case Detect:
+        return "检测";
+    case Quality:
+        return "质量";
+    default:
+        return "?";
+    }
+}
+
+const char* FaceMetrics::issueName(FaceQuality::Issue issue)
+{
+    switch (issue)
+    {
+    case FaceQuality::TooSmall:
+        return "过小";
+    case FaceQuality::Blurry:
+        return "模糊";
+    case FaceQuality::TooDark:
+        return "过暗";
+    case FaceQuality::TooBright:
+        return "过亮";
+    case FaceQuality::LowContrast:
+        return "低对比";
+    default:
+        return "?";
+    }
+}
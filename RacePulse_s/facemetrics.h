@@ -0,0 +1,52 @@
+#ifndef FACEMETRICS_H
+#define FACEMETRICS_H
+
+#include <QString>
+
+#include <atomic>
+
+#include "facequality.h"
+
+// 人脸处理各阶段的耗时统计与质量检查拦截次数，所有线程共用，只用原子计数，不加锁
+class FaceMetrics
+{
+private:
+    FaceMetrics();
+    FaceMetrics(const FaceMetrics&) = delete;            // 删除复制构造函数
+    FaceMetrics& operator=(const FaceMetrics&) = delete; // 删除赋值操作符
+    ~FaceMetrics();
+
+public:
+    enum Stage
+    {
+        Decode,  // 图片解码
+        Detect,  // 人脸检测
+        Quality, // 质量检查
+        StageCount
+    };
+
+    static FaceMetrics& getInstance();
+
+    void record(Stage stage, qint64 nsecs);
+    void recordRejected(FaceQuality::Issue issue); // 质量检查拒绝，省下一次特征提取
+    void recordCancelled();                        // 排队中的推理被取消
+    quint64 inferencesAvoided() const;
+    QString summary() const; // 各阶段次数、平均与最大耗时及拦截次数，用于日志
+
+private:
+    static const char* stageName(Stage stage);
+    static const char* issueName(FaceQuality::Issue issue);
+
+    struct StageStats
+    {
+        std::atomic<quint64> count{0};
+        std::atomic<quint64> totalNs{0};
+        std::atomic<quint64> maxNs{0};
+    };
+
+    StageStats stages[StageCount];
+    std::atomic<quint64> rejected[FaceQuality::IssueCount] = {};
+    std::atomic<quint64> cancelled{0};
+};
+
+#endif // FACEMETRICS_H
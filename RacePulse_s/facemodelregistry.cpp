@@ -0,0 +1,306 @@
+#include "facemodelregistry.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+#include "qdebug.h"
+
+FaceModelRegistry& FaceModelRegistry::getInstance()
+{
+    static FaceModelRegistry instance;
+    return instance;
+}
+
+FaceModelRegistry::FaceModelRegistry()
+{
+}
+
+FaceModelRegistry::~FaceModelRegistry()
+{
+}
+
+template <typename T, typename Build>
+T& FaceModelRegistry::current(Slot<T>& slot, Slot<T>& prepared, Build build)
+{
+    const quint64 published = generation();
+    if (slot.generation == published)
+    {
+        return slot.model;
+    }
+
+    // 预热时已构建好的实例直接换上
+    if (prepared.generation == published)
+    {
+        slot = std::move(prepared);
+        prepared = Slot<T>();
+        return slot.model;
+    }
+
+    // 没有预先构建，从内存中的模型数据构建，不再访问磁盘
+    QReadLocker locker(&lock);
+    slot.generation = active.generation;
+    slot.model = T();
+    if (slot.generation != 0)
+    {
+        slot.model = build(active);
+    }
+    return slot.model;
+}
+
+template <typename T, typename Build>
+T& FaceModelRegistry::prepare(Slot<T>& slot, Build build)
+{
+    // 没有待切换的版本，或本线程已构建过
+    QReadLocker locker(&lock);
+    if (staged.generation == 0 || slot.generation == staged.generation)
+    {
+        return slot.model;
+    }
+    slot.generation = staged.generation;
+    slot.model = build(staged);
+    return slot.model;
+}
+
+bool FaceModelRegistry::load()
+{
+    if (!stage())
+    {
+        return false;
+    }
+    publish();
+    return true;
+}
+
+bool FaceModelRegistry::stage()
+{
+    QMutexLocker loadLocker(&loadMutex);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // 读取最新配置，切换前不影响当前版本
+    ModelData next;
+
+    QFile cascadeFile(next.config.cascadePath);
+    if (!cascadeFile.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "无法读取人脸检测模型:" << next.config.cascadePath;
+        return false;
+    }
+    const QByteArray cascadeData = cascadeFile.readAll();
+
+    // 指定精度的模型不存在时退回 fp32
+    QString embeddingPath = modelFile(next.config, next.config.precision);
+    if (!QFile::exists(embeddingPath) && next.config.precision != "fp32")
+    {
+        qWarning() << "人脸特征模型" << next.config.precision << "版本不存在，改用 fp32:" << embeddingPath;
+        embeddingPath = modelFile(next.config, "fp32");
+    }
+
+    QFile embeddingFile(embeddingPath);
+    if (!embeddingFile.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "无法读取人脸特征模型:" << embeddingPath;
+        return false;
+    }
+    const QByteArray embeddingData = embeddingFile.readAll();
+
+    next.cascadeXml.assign(cascadeData.constData(), cascadeData.size());
+    next.embeddingOnnx.assign(embeddingData.begin(), embeddingData.end());
+
+    // 先在当前线程解析一次，模型损坏时不替换已加载的版本
+    try
+    {
+        if (buildCascade(next).empty())
+        {
+            qWarning() << "人脸检测模型格式错误:" << next.config.cascadePath;
+            return false;
+        }
+        QString error;
+        if (!EmbeddingBackend::create(next.config.backend, next.embeddingOnnx, error))
+        {
+            qWarning() << "人脸特征模型加载失败:" << embeddingPath << next.config.backend << error;
+            return false;
+        }
+        if (!next.config.dnnDetectorPath.isEmpty() && !buildYunet(next))
+        {
+            qWarning() << "人脸检测模型 YuNet 加载失败:" << next.config.dnnDetectorPath;
+            return false;
+        }
+    }
+    catch (const cv::Exception& e)
+    {
+        qWarning() << "加载人脸模型失败:" << QString::fromStdString(e.what());
+        return false;
+    }
+
+    next.generation = ++lastGeneration;
+    const QString backend = next.config.backend;
+    {
+        QWriteLocker locker(&lock);
+        staged = std::move(next);
+    }
+
+    qDebug() << "人脸模型已校验，版本" << lastGeneration << "耗时" << timer.elapsed() << "ms"
+             << "特征模型:" << embeddingPath << "推理后端:" << backend;
+    return true;
+}
+
+void FaceModelRegistry::publish()
+{
+    QMutexLocker loadLocker(&loadMutex);
+    QWriteLocker locker(&lock);
+    if (staged.generation == 0)
+    {
+        return;
+    }
+
+    // 数据与版本号一起替换，各线程下次使用时换上已构建好的实例
+    active = std::move(staged);
+    staged = ModelData();
+    m_generation.store(active.generation, std::memory_order_release);
+    qDebug() << "人脸模型已切换到版本" << active.generation;
+}
+
+void FaceModelRegistry::prepareDetectors()
+{
+    ThreadModels& models = threadModels();
+
+    // 检测时配置了 YuNet 就只用 YuNet，只构建会用到的检测器
+    bool useYunet = false;
+    {
+        QReadLocker locker(&lock);
+        const ModelData& target = staged.generation ? staged : active;
+        useYunet = !target.config.dnnDetectorPath.isEmpty();
+    }
+    // 没有待切换版本时（如启动时）构建当前版本
+    if (useYunet)
+    {
+        if (!prepare(models.stagedYunet, buildYunet))
+        {
+            dnnDetector();
+        }
+    }
+    else if (prepare(models.stagedCascade, buildCascade).empty())
+    {
+        detector();
+    }
+}
+
+EmbeddingBackend* FaceModelRegistry::prepareEmbedding()
+{
+    ThreadModels& models = threadModels();
+    if (EmbeddingBackend* backend = prepare(models.stagedEmbedding, buildEmbedding).get())
+    {
+        return backend;
+    }
+    return embeddingBackend();
+}
+
+bool FaceModelRegistry::isLoaded() const
+{
+    return generation() != 0;
+}
+
+quint64 FaceModelRegistry::generation() const
+{
+    return m_generation.load(std::memory_order_acquire);
+}
+
+cv::CascadeClassifier& FaceModelRegistry::detector()
+{
+    ThreadModels& models = threadModels();
+    return current(models.cascade, models.stagedCascade, buildCascade);
+}
+
+EmbeddingBackend* FaceModelRegistry::embeddingBackend()
+{
+    ThreadModels& models = threadModels();
+    return current(models.embedding, models.stagedEmbedding, buildEmbedding).get();
+}
+
+cv::Ptr<cv::FaceDetectorYN> FaceModelRegistry::dnnDetector()
+{
+    ThreadModels& models = threadModels();
+    return current(models.yunet, models.stagedYunet, buildYunet);
+}
+
+QString FaceModelRegistry::embeddingModelFile(const QString& precision) const
+{
+    QReadLocker locker(&lock);
+    return modelFile(active.config, precision);
+}
+
+QString FaceModelRegistry::backendName() const
+{
+    QReadLocker locker(&lock);
+    return active.config.backend;
+}
+
+QString FaceModelRegistry::modelFile(const ModelConfig& modelConfig, const QString& precision)
+{
+    const QFileInfo base(modelConfig.embeddingModelPath);
+    const QDir dir = modelConfig.modelDirectory.isEmpty() ? base.dir() : QDir(modelConfig.modelDirectory);
+    if (precision == "fp32")
+    {
+        return dir.filePath(base.fileName());
+    }
+    return dir.filePath(QString("%1_%2.%3").arg(base.completeBaseName(), precision, base.suffix()));
+}
+
+FaceModelRegistry::ThreadModels& FaceModelRegistry::threadModels()
+{
+    thread_local ThreadModels models;
+    return models;
+}
+
+cv::CascadeClassifier FaceModelRegistry::buildCascade(const ModelData& data)
+{
+    cv::CascadeClassifier cascade;
+    try
+    {
+        cv::FileStorage fs(data.cascadeXml, cv::FileStorage::READ | cv::FileStorage::MEMORY);
+        cascade.read(fs.getFirstTopLevelNode());
+    }
+    catch (const cv::Exception& e)
+    {
+        qWarning() << "构建人脸检测模型失败:" << QString::fromStdString(e.what());
+    }
+    qDebug() << "线程人脸检测模型已构建，版本" << data.generation;
+    return cascade;
+}
+
+cv::Ptr<cv::FaceDetectorYN> FaceModelRegistry::buildYunet(const ModelData& data)
+{
+    if (data.config.dnnDetectorPath.isEmpty())
+    {
+        return cv::Ptr<cv::FaceDetectorYN>();
+    }
+    try
+    {
+        // FaceDetectorYN 只能从文件创建，每个线程读取一次
+        return cv::FaceDetectorYN::create(data.config.dnnDetectorPath.toStdString(), "", cv::Size(320, 320));
+    }
+    catch (const cv::Exception& e)
+    {
+        qWarning() << "构建 YuNet 检测模型失败:" << QString::fromStdString(e.what());
+    }
+    return cv::Ptr<cv::FaceDetectorYN>();
+}
+
+std::unique_ptr<EmbeddingBackend> FaceModelRegistry::buildEmbedding(const ModelData& data)
+{
+    QString error;
+    std::unique_ptr<EmbeddingBackend> backend = EmbeddingBackend::create(data.config.backend, data.embeddingOnnx, error);
+    if (!backend)
+    {
+        qWarning() << "构建线程推理后端失败:" << error;
+    }
+    else
+    {
+        qDebug() << "线程推理后端已构建，版本" << data.generation;
+    }
+    return backend;
+}
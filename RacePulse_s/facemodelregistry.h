@@ -0,0 +1,120 @@
+#ifndef FACEMODELREGISTRY_H
+#define FACEMODELREGISTRY_H
+
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QSettings>
+#include <QString>
+#include <opencv2/objdetect.hpp>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "embeddingbackend.h"
+
+// 进程级人脸模型注册表
+// 启动时把检测器与特征提取模型文件读入内存一次，各线程按需从内存构建自己的实例；
+// CascadeClassifier 与推理后端都不能跨线程并发使用，每个线程各持一份，
+// 连接本身不再持有任何模型。
+// 特征模型可配置模型目录（face/model_dir）与精度（face/embedding_precision：fp32、fp16、int8），
+// 低精度版本按 <模型名>_fp16.onnx、<模型名>_int8.onnx 命名，输入输出需保持 float32
+class FaceModelRegistry
+{
+private:
+    FaceModelRegistry();
+    FaceModelRegistry(const FaceModelRegistry&) = delete;            // 删除复制构造函数
+    FaceModelRegistry& operator=(const FaceModelRegistry&) = delete; // 删除赋值操作符
+    ~FaceModelRegistry();
+
+public:
+    static FaceModelRegistry& getInstance();
+
+    // 读取配置与模型文件并在当前线程校验，随即生效；服务器开始监听前调用
+    bool load();
+
+    // 热更新分三步：stage 读取并校验新模型（可在后台线程调用），各线程调用 prepare* 提前构建新版本，
+    // 全部完成后 publish 切换；切换前各线程继续使用旧实例，切换后直接换上已构建好的实例
+    bool stage();
+    void prepareDetectors();              // 只构建检测时会用到的那一种检测器
+    EmbeddingBackend* prepareEmbedding(); // 返回待切换版本的实例（没有待切换版本时为当前版本），用于预热推理
+    void publish();                       // 没有待切换版本时不做任何事
+
+    bool isLoaded() const;
+
+    // 当前线程的模型实例，首次使用或模型更新后从内存重新构建；三类模型分别构建，只构建用到的
+    cv::CascadeClassifier& detector();
+    EmbeddingBackend* embeddingBackend();      // 模型不可用时为空
+    cv::Ptr<cv::FaceDetectorYN> dnnDetector(); // 未配置 YuNet 模型时为空
+
+    quint64 generation() const; // 当前生效的版本，未加载时为 0
+
+    QString embeddingModelFile(const QString& precision) const; // 指定精度的特征模型路径
+    QString backendName() const;
+
+private:
+    // 每次 stage 时重新读取
+    struct ModelConfig
+    {
+        // 使用配置文件，默认沿用原来的模型位置
+        QString cascadePath = QSettings().value("face/cascade", "D:/Lib/OpenCV-MinGW-Build-OpenCV-4.5.5-x64/etc/haarcascades/haarcascade_frontalface_default.xml").toString();
+        QString embeddingModelPath = QSettings().value("face/embedding_model", "D:/Personal Data/Qt/face_test/w600k_r50.onnx").toString();
+        QString dnnDetectorPath = QSettings().value("face/yunet_model", "").toString();      // 可选的 YuNet 检测模型
+        QString modelDirectory = QSettings().value("face/model_dir", "").toString();         // 为空时使用 face/embedding_model 所在目录
+        QString precision = QSettings().value("face/embedding_precision", "fp32").toString(); // fp32、fp16、int8
+        QString backend = QSettings().value("face/backend", "opencv").toString();             // opencv、onnxruntime
+    };
+
+    // 一个版本的配置与模型数据
+    struct ModelData
+    {
+        quint64 generation = 0; // 0 表示没有数据
+        ModelConfig config;
+        std::string cascadeXml;
+        std::vector<uchar> embeddingOnnx;
+    };
+
+    // 线程内的一个模型实例及其版本
+    template <typename T>
+    struct Slot
+    {
+        quint64 generation = 0;
+        T model{};
+    };
+
+    // 每类模型一个当前实例和一个预先构建、等待切换的实例
+    struct ThreadModels
+    {
+        Slot<cv::CascadeClassifier> cascade;
+        Slot<cv::CascadeClassifier> stagedCascade;
+        Slot<cv::Ptr<cv::FaceDetectorYN>> yunet;
+        Slot<cv::Ptr<cv::FaceDetectorYN>> stagedYunet;
+        Slot<std::unique_ptr<EmbeddingBackend>> embedding;
+        Slot<std::unique_ptr<EmbeddingBackend>> stagedEmbedding;
+    };
+
+    static ThreadModels& threadModels();
+
+    template <typename T, typename Build>
+    T& current(Slot<T>& slot, Slot<T>& prepared, Build build);
+    template <typename T, typename Build>
+    T& prepare(Slot<T>& slot, Build build);
+
+    static cv::CascadeClassifier buildCascade(const ModelData& data);
+    static cv::Ptr<cv::FaceDetectorYN> buildYunet(const ModelData& data);
+    static std::unique_ptr<EmbeddingBackend> buildEmbedding(const ModelData& data);
+
+    static QString modelFile(const ModelConfig& modelConfig, const QString& precision);
+
+private:
+    QMutex loadMutex; // 串行化 stage 与 publish
+
+    mutable QReadWriteLock lock; // 保护 active 与 staged
+    ModelData active;            // 当前生效的版本
+    ModelData staged;            // 已校验、等待切换的版本
+    quint64 lastGeneration = 0;  // 已分配的最大版本号，受 loadMutex 保护
+    std::atomic<quint64> m_generation{0};
+};
+
+#endif // FACEMODELREGISTRY_H
@@ -0,0 +1,237 @@
+#include "facepipelinebenchmark.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QImage>
+#include <opencv2/dnn.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/objdetect.hpp>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "embeddingbackend.h"
+#include "facedetector.h"
+#include "faceinferencepool.h"
+#include "facemodelregistry.h"
+#include "facequality.h"
+#include "qdebug.h"
+
+namespace
+{
+constexpr int REPEAT = 5; // 每张图每个阶段重复次数
+
+struct Samples
+{
+    std::vector<qint64> before;
+    std::vector<qint64> after;
+};
+
+// 一种分辨率下各阶段的耗时
+struct Stages
+{
+    Samples decode;
+    Samples detect;
+    Samples preprocess;
+    std::vector<qint64> quality;
+    int rejected = 0;
+};
+
+// 摄像头常见的三种分辨率，每张图都缩放到这些尺寸后再测，单独报告
+const std::vector<cv::Size> RESOLUTIONS = {cv::Size(640, 480), cv::Size(1280, 720), cv::Size(1920, 1080)};
+
+void measure(std::vector<qint64>& samples, const std::function<void()>& stage)
+{
+    for (int i = 0; i < REPEAT; ++i)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        stage();
+        samples.push_back(timer.nsecsElapsed());
+    }
+}
+
+double medianMs(std::vector<qint64> samples)
+{
+    if (samples.empty())
+    {
+        return -1.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2] / 1e6;
+}
+
+// 原来的解码：QImage 解码后转换格式再拷成 cv::Mat
+cv::Mat decodeViaQImage(const QByteArray& data)
+{
+    QImage image;
+    if (!image.loadFromData(data))
+    {
+        return cv::Mat();
+    }
+    image = image.convertToFormat(QImage::Format_RGBA8888);
+    const cv::Mat rgba(image.height(), image.width(), CV_8UC4, const_cast<uchar*>(image.constBits()), image.bytesPerLine());
+    cv::Mat bgr;
+    cv::cvtColor(rgba, bgr, cv::COLOR_RGBA2BGR);
+    return bgr;
+}
+
+// 原来的检测：在原图上做直方图均衡与多尺度检测
+void detectFullResolution(cv::CascadeClassifier& cascade, const cv::Mat& bgr)
+{
+    cv::Mat gray;
+    cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+    cv::equalizeHist(gray, gray);
+    std::vector<cv::Rect> faces;
+    cascade.detectMultiScale(gray, faces, 1.1, 3, 0, cv::Size(30, 30));
+}
+
+// 原来的预处理：拷贝、缩放、逐步归一化后再由 blobFromImage 换通道和排布
+cv::Mat preprocessMultiPass(const cv::Mat& face)
+{
+    const int size = EmbeddingBackend::INPUT_SIZE;
+    cv::Mat processed = face.clone();
+    cv::Mat resized;
+    cv::resize(processed, resized, cv::Size(size, size));
+
+    cv::Mat floatImage;
+    resized.convertTo(floatImage, CV_32F);
+    floatImage = floatImage / 255.0;
+
+    cv::Mat normalized;
+    cv::subtract(floatImage, cv::Scalar(0.5, 0.5, 0.5), normalized);
+    cv::multiply(normalized, cv::Scalar(2.0, 2.0, 2.0), normalized);
+    return cv::dnn::blobFromImage(normalized, 1.0, cv::Size(size, size), cv::Scalar(0, 0, 0), true, false);
+}
+
+QString formatMs(double ms)
+{
+    return ms < 0.0 ? QString("-") : QString::number(ms, 'f', 3);
+}
+
+// 测一张图各阶段的耗时，data 为该图按当前分辨率编码后的 JPEG
+void measureFrame(const QByteArray& data, bool modelsLoaded, Stages& stages, cv::Mat& resized, std::vector<float>& blob)
+{
+    const cv::Mat encoded(1, int(data.size()), CV_8UC1, const_cast<char*>(data.constData()));
+    cv::Mat image = cv::imdecode(encoded, cv::IMREAD_COLOR);
+
+    measure(stages.decode.before, [&]() { decodeViaQImage(data); });
+    measure(stages.decode.after, [&]() { cv::imdecode(encoded, cv::IMREAD_COLOR, &image); });
+
+    // 检测到一张人脸时用它的框，否则取中间的正方形，保证后面的阶段都有输入
+    std::vector<FaceDetector::Detection> faces;
+    double faceRatio = -1.0;
+    cv::Rect box(0, 0, image.cols, image.rows);
+    if (modelsLoaded)
+    {
+        cv::CascadeClassifier& cascade = FaceModelRegistry::getInstance().detector();
+        measure(stages.detect.before, [&]() { detectFullResolution(cascade, image); });
+        measure(stages.detect.after, [&]() { FaceDetector::detect(image, faces); });
+    }
+    if (faces.size() == 1)
+    {
+        box = faces[0].box;
+        faceRatio = double(box.width) / image.cols;
+    }
+    else
+    {
+        const int side = std::min(image.cols, image.rows);
+        box = cv::Rect((image.cols - side) / 2, (image.rows - side) / 2, side, side);
+    }
+
+    cv::Mat face;
+    cv::resize(image(box), face, cv::Size(EmbeddingBackend::INPUT_SIZE, EmbeddingBackend::INPUT_SIZE));
+
+    measure(stages.preprocess.before, [&]() { preprocessMultiPass(face); });
+    measure(stages.preprocess.after, [&]() { FaceInferencePool::preprocess(face, resized, blob.data()); });
+
+    FaceQuality::Issue issue = FaceQuality::None;
+    measure(stages.quality, [&]() { issue = FaceQuality::check(face, faceRatio); });
+    if (issue != FaceQuality::None)
+    {
+        ++stages.rejected;
+    }
+}
+
+void report(const cv::Size& resolution, const Stages& stages, int images)
+{
+    qInfo().noquote() << QString("%1x%2").arg(resolution.width).arg(resolution.height);
+    qInfo().noquote() << "阶段        原来ms    现在ms    加速";
+    const auto row = [](const QString& stage, const Samples& samples)
+    {
+        const double before = medianMs(samples.before);
+        const double after = medianMs(samples.after);
+        qInfo().noquote() << QString("%1 %2 %3 %4")
+                                 .arg(stage, -10)
+                                 .arg(formatMs(before), 8)
+                                 .arg(formatMs(after), 9)
+                                 .arg(before > 0.0 && after > 0.0 ? QString::number(before / after, 'f', 1) : QString("-"), 7);
+    };
+    row("解码", stages.decode);
+    row("检测", stages.detect);
+    row("预处理", stages.preprocess);
+    // 被拒绝的图片不再占用一次特征提取
+    qInfo().noquote() << QString("质量检查 %1 ms，拒绝 %2 / %3 张").arg(formatMs(medianMs(stages.quality))).arg(stages.rejected).arg(images);
+}
+} // namespace
+
+int FacePipelineBenchmark::run(const QString& imageDirectory)
+{
+    QDir dir(imageDirectory);
+    const QStringList files = dir.entryList({"*.jpg", "*.jpeg", "*.png", "*.bmp"}, QDir::Files, QDir::Name);
+    if (files.isEmpty())
+    {
+        qWarning() << "目录中没有图片:" << imageDirectory;
+        return 1;
+    }
+
+    // 检测需要级联模型，加载失败时只跳过检测阶段
+    const bool modelsLoaded = FaceModelRegistry::getInstance().load();
+    if (!modelsLoaded)
+    {
+        qWarning() << "人脸模型加载失败，跳过检测阶段";
+    }
+
+    std::vector<Stages> stages(RESOLUTIONS.size());
+    int images = 0;
+
+    cv::Mat resized;
+    std::vector<float> blob(EmbeddingBackend::IMAGE_FLOATS);
+    std::vector<uchar> jpeg;
+
+    for (const QString& name : files)
+    {
+        const cv::Mat image = cv::imread(dir.filePath(name).toStdString(), cv::IMREAD_COLOR);
+        if (image.empty())
+        {
+            qWarning() << "跳过无法解码的图片:" << name;
+            continue;
+        }
+        ++images;
+
+        // 缩放到目标分辨率后重新编码，解码阶段测的是该分辨率下客户端实际上传的 JPEG
+        for (size_t i = 0; i < stages.size(); ++i)
+        {
+            cv::Mat frame;
+            cv::resize(image, frame, RESOLUTIONS[i], 0, 0, cv::INTER_AREA);
+            cv::imencode(".jpg", frame, jpeg, {cv::IMWRITE_JPEG_QUALITY, 90});
+            const QByteArray data(reinterpret_cast<const char*>(jpeg.data()), int(jpeg.size()));
+            measureFrame(data, modelsLoaded, stages[i], resized, blob);
+        }
+    }
+
+    if (images == 0)
+    {
+        qWarning() << "目录中没有可用的图片:" << imageDirectory;
+        return 1;
+    }
+
+    qInfo().noquote() << QString("图片数 %1，每个阶段每张重复 %2 次，检测工作图宽度 %3").arg(images).arg(REPEAT).arg(FaceDetector::workingWidth());
+    for (size_t i = 0; i < stages.size(); ++i)
+    {
+        report(RESOLUTIONS[i], stages[i], images);
+    }
+    return 0;
+}
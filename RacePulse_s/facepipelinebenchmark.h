@@ -0,0 +1,17 @@
+#ifndef FACEPIPELINEBENCHMARK_H
+#define FACEPIPELINEBENCHMARK_H
+
+#include <QString>
+
+// 人脸图片处理各阶段对比，命令行运行：RacePulse_s --bench-face <图片目录>
+// 目录中放摄像头拍摄的整幅图片（PNG、JPEG），每张缩放到 640x480、1280x720、1920x1080 后重新编码为 JPEG，
+// 按分辨率分别输出原来的做法与现在的做法的耗时中位数：
+// 解码（QImage 中转 / 直接 imdecode）、检测（原图 / 缩小的工作图）、
+// 预处理（多次遍历 + blobFromImage / 单次遍历），以及质量检查的耗时与拒绝数
+class FacePipelineBenchmark
+{
+public:
+    static int run(const QString& imageDirectory);
+};
+
+#endif // FACEPIPELINEBENCHMARK_H
@@ -0,0 +1,90 @@
+#include "facequality.h"
+
+#include <QSettings>
+#include <opencv2/imgproc.hpp>
+
+namespace
+{
+// 阈值只在首次使用时读取一次；默认值偏宽松，只拦截明显无法通过比对的图片
+struct Thresholds
+{
+    double minFaceRatio = QSettings().value("face/min_face_ratio", 0.12).toDouble();
+    double minSharpness = QSettings().value("face/min_sharpness", 40.0).toDouble();
+    double minBrightness = QSettings().value("face/min_brightness", 40.0).toDouble();
+    double maxBrightness = QSettings().value("face/max_brightness", 220.0).toDouble();
+    double minContrast = QSettings().value("face/min_contrast", 15.0).toDouble();
+};
+
+const Thresholds& thresholds()
+{
+    static const Thresholds instance;
+    return instance;
+}
+} // namespace
+
+FaceQuality::Issue FaceQuality::check(const cv::Mat& face, double faceRatio)
+{
+    const Thresholds& limits = thresholds();
+
+    // 尺寸检查不需要像素，放在最前面
+    if (faceRatio >= 0.0 && faceRatio < limits.minFaceRatio)
+    {
+        return TooSmall;
+    }
+
+    thread_local cv::Mat gray;
+    thread_local cv::Mat laplacian;
+    if (face.channels() == 3)
+    {
+        cv::cvtColor(face, gray, cv::COLOR_BGR2GRAY);
+    }
+    else
+    {
+        face.copyTo(gray);
+    }
+
+    cv::Scalar mean;
+    cv::Scalar stddev;
+    cv::meanStdDev(gray, mean, stddev);
+    if (mean[0] < limits.minBrightness)
+    {
+        return TooDark;
+    }
+    if (mean[0] > limits.maxBrightness)
+    {
+        return TooBright;
+    }
+    if (stddev[0] < limits.minContrast)
+    {
+        return LowContrast;
+    }
+
+    // 拉普拉斯响应的方差，越模糊越小；16 位整型足够容纳 8 位图像的响应
+    cv::Laplacian(gray, laplacian, CV_16S);
+    cv::meanStdDev(laplacian, mean, stddev);
+    if (stddev[0] * stddev[0] < limits.minSharpness)
+    {
+        return Blurry;
+    }
+
+    return None;
+}
+
+const char* FaceQuality::reason(Issue issue)
+{
+    switch (issue)
+    {
+    case TooSmall:
+        return "人脸过小，请靠近摄像头";
+    case Blurry:
+        return "画面模糊，请保持静止";
+    case TooDark:
+        return "光线过暗，请调整光线";
+    case TooBright:
+        return "光线过亮，请避免强光直射";
+    case LowContrast:
+        return "画面对比度过低，请调整光线";
+    default:
+        return "";
+    }
+}
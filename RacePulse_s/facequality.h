@@ -0,0 +1,29 @@
+#ifndef FACEQUALITY_H
+#define FACEQUALITY_H
+
+#include <opencv2/core.hpp>
+
+// 特征提取前的人脸质量检查
+// 在 112x112 的裁剪图上计算拉普拉斯方差（模糊）、灰度均值与标准差（曝光、对比度），
+// 再结合人脸框占画面的比例，明显不合格的图片直接拒绝，不占用推理线程
+class FaceQuality
+{
+public:
+    enum Issue
+    {
+        None,
+        TooSmall,    // 人脸占画面比例过小
+        Blurry,      // 拉普拉斯方差过低
+        TooDark,     // 平均亮度过低
+        TooBright,   // 平均亮度过高
+        LowContrast, // 灰度标准差过低
+        IssueCount
+    };
+
+    // faceRatio 为人脸框宽度与画面宽度之比，未知时（客户端已裁剪）传负数跳过尺寸检查
+    static Issue check(const cv::Mat& face, double faceRatio);
+
+    static const char* reason(Issue issue); // 返回给客户端的提示
+};
+
+#endif // FACEQUALITY_H
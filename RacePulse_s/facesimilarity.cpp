@@ -0,0 +1,224 @@
+#include "facesimilarity.h"
+
+#include <cfloat>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FACE_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+using BestDotFn = float (*)(const float*, const float*, int, int, int*);
+using DotFn = float (*)(const float*, const float*, int);
+
+float dotScalar(const float* a, const float* b, int dim)
+{
+    // 四路累加，减少依赖链，编译器也更容易自动向量化
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int k = 0;
+    for (; k + 4 <= dim; k += 4)
+    {
+        s0 += a[k] * b[k];
+        s1 += a[k + 1] * b[k + 1];
+        s2 += a[k + 2] * b[k + 2];
+        s3 += a[k + 3] * b[k + 3];
+    }
+    for (; k < dim; ++k)
+    {
+        s0 += a[k] * b[k];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+float bestDotScalar(const float* probe, const float* templates, int count, int dim, int* bestIndex)
+{
+    float best = -FLT_MAX;
+    for (int i = 0; i < count; ++i)
+    {
+        const float similarity = dotScalar(probe, templates + static_cast<long long>(i) * dim, dim);
+        if (similarity > best)
+        {
+            best = similarity;
+            *bestIndex = i;
+        }
+    }
+    return best;
+}
+
+#ifdef FACE_SIMD_X86
+__attribute__((target("avx2,fma"))) inline float dotAvx2Inline(const float* a, const float* b, int dim)
+{
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int k = 0;
+    for (; k + 16 <= dim; k += 16)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + k + 8), _mm256_loadu_ps(b + k + 8), acc1);
+    }
+    for (; k + 8 <= dim; k += 8)
+    {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + k), _mm256_loadu_ps(b + k), acc0);
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+
+    // 水平求和
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    __m128 shuf = _mm_movehdup_ps(sum);
+    sum = _mm_add_ps(sum, shuf);
+    shuf = _mm_movehl_ps(shuf, sum);
+    sum = _mm_add_ss(sum, shuf);
+    float result = _mm_cvtss_f32(sum);
+
+    for (; k < dim; ++k)
+    {
+        result += a[k] * b[k];
+    }
+    return result;
+}
+
+__attribute__((target("avx2,fma"))) float dotAvx2(const float* a, const float* b, int dim)
+{
+    return dotAvx2Inline(a, b, dim);
+}
+
+__attribute__((target("avx2,fma"))) float bestDotAvx2(const float* probe, const float* templates, int count, int dim, int* bestIndex)
+{
+    float best = -FLT_MAX;
+    for (int i = 0; i < count; ++i)
+    {
+        const float similarity = dotAvx2Inline(probe, templates + static_cast<long long>(i) * dim, dim);
+        if (similarity > best)
+        {
+            best = similarity;
+            *bestIndex = i;
+        }
+    }
+    return best;
+}
+
+__attribute__((target("avx512f"))) inline float dotAvx512Inline(const float* a, const float* b, int dim)
+{
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    int k = 0;
+    for (; k + 32 <= dim; k += 32)
+    {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + k), _mm512_loadu_ps(b + k), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + k + 16), _mm512_loadu_ps(b + k + 16), acc1);
+    }
+    for (; k + 16 <= dim; k += 16)
+    {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + k), _mm512_loadu_ps(b + k), acc0);
+    }
+
+    // 尾部用掩码加载，不足 16 个的部分补零
+    if (k < dim)
+    {
+        const __mmask16 mask = static_cast<__mmask16>((1u << (dim - k)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + k), _mm512_maskz_loadu_ps(mask, b + k), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f"))) float dotAvx512(const float* a, const float* b, int dim)
+{
+    return dotAvx512Inline(a, b, dim);
+}
+
+__attribute__((target("avx512f"))) float bestDotAvx512(const float* probe, const float* templates, int count, int dim, int* bestIndex)
+{
+    float best = -FLT_MAX;
+    for (int i = 0; i < count; ++i)
+    {
+        const float similarity = dotAvx512Inline(probe, templates + static_cast<long long>(i) * dim, dim);
+        if (similarity > best)
+        {
+            best = similarity;
+            *bestIndex = i;
+        }
+    }
+    return best;
+}
+#endif
+
+struct Kernel
+{
+    BestDotFn bestDot;
+    DotFn dot;
+    const char* name;
+};
+
+// 当前 CPU 支持的实现，从快到慢排列，最后一个总是标量实现
+const std::vector<Kernel>& supportedKernels()
+{
+    static const std::vector<Kernel> kernels = []()
+    {
+        std::vector<Kernel> supported;
+#ifdef FACE_SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            supported.push_back({bestDotAvx512, dotAvx512, "avx512"});
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        {
+            supported.push_back({bestDotAvx2, dotAvx2, "avx2"});
+        }
+#endif
+        supported.push_back({bestDotScalar, dotScalar, "scalar"});
+        return supported;
+    }();
+    return kernels;
+}
+
+// 首次调用时检测 CPU，之后固定使用同一实现
+const Kernel& kernel()
+{
+    return supportedKernels().front();
+}
+
+FaceSimilarity::Match nearestWithKernel(const Kernel& selected, const float* probe, const float* templates, int count, int dim)
+{
+    FaceSimilarity::Match match{FLT_MAX, -1};
+    if (!probe || !templates || count <= 0 || dim <= 0)
+    {
+        return match;
+    }
+
+    const float best = selected.bestDot(probe, templates, count, dim, &match.index);
+    match.distance = 1.0f - best;
+    return match;
+}
+} // namespace
+
+FaceSimilarity::Match FaceSimilarity::nearest(const float* probe, const float* templates, int count, int dim)
+{
+    return nearestWithKernel(kernel(), probe, templates, count, dim);
+}
+
+float FaceSimilarity::dot(const float* a, const float* b, int dim)
+{
+    return kernel().dot(a, b, dim);
+}
+
+const char* FaceSimilarity::kernelName()
+{
+    return kernel().name;
+}
+
+bool FaceSimilarity::nearestWith(const char* kernel, const float* probe, const float* templates, int count, int dim, Match& match)
+{
+    for (const Kernel& candidate : supportedKernels())
+    {
+        if (std::strcmp(candidate.name, kernel) == 0)
+        {
+            match = nearestWithKernel(candidate, probe, templates, count, dim);
+            return true;
+        }
+    }
+    return false;
+}
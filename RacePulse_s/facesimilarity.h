@@ -0,0 +1,25 @@
+#ifndef FACESIMILARITY_H
+#define FACESIMILARITY_H
+
+// 人脸特征比对内核
+// 一个探针向量与连续存放的多个模板逐一求点积，返回余弦距离最小的模板；
+// 所有向量都必须已做 L2 归一化。运行时按 CPU 支持选择 AVX-512 / AVX2 / 标量实现
+class FaceSimilarity
+{
+public:
+    struct Match
+    {
+        float distance; // 1 - 余弦相似度，没有模板时为 FLT_MAX
+        int index;      // 最近模板的下标，没有模板时为 -1
+    };
+
+    static Match nearest(const float* probe, const float* templates, int count, int dim);
+    static float dot(const float* a, const float* b, int dim);
+
+    static const char* kernelName(); // 当前使用的实现，用于日志
+
+    // 基准对比用：指定实现（"avx512"、"avx2"、"scalar"），CPU 不支持该实现时返回 false
+    static bool nearestWith(const char* kernel, const float* probe, const float* templates, int count, int dim, Match& match);
+};
+
+#endif // FACESIMILARITY_H
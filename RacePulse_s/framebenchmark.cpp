@@ -0,0 +1,233 @@
+#include "framebenchmark.h"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <random>
+#include <vector>
+
+#include "framecodec.h"
+#include "qdebug.h"
+
+namespace
+{
+constexpr int CHUNK_SIZE = 1460; // 一个 TCP 报文段，接近 readyRead 每次拿到的数据量
+constexpr int RUNS = 3;          // 取最快的一次
+
+struct Scenario
+{
+    QString name;
+    CodecOptions options;
+    QJsonObject json;
+    Attachments attachments;
+};
+
+CodecOptions v2Options(FrameType encoding, Compression compression)
+{
+    CodecOptions options;
+    options.version = PROTOCOL_V2;
+    options.encoding = encoding;
+    options.compression = compression;
+    return options;
+}
+
+QJsonObject contestList()
+{
+    QJsonArray contests;
+    for (int i = 0; i < 200; ++i)
+    {
+        QJsonObject contest;
+        contest["contest_id"] = QString::number(10000 + i);
+        contest["name"] = QString("第%1届校园马拉松").arg(i + 1);
+        contest["start_time"] = "2024-06-01 08:00:00";
+        contest["end_time"] = "2024-06-01 12:00:00";
+        contest["location"] = "东区体育场";
+        contest["participants"] = 100 + i;
+        contests.append(contest);
+    }
+    QJsonObject json;
+    json["tag"] = "search_contest";
+    json["result"] = "success";
+    json["contests"] = contests;
+    return json;
+}
+
+// 模拟登录应答：200KB 头像作为附件，v1 下会转为 Base64 字段
+Scenario avatarScenario(const QString& name, const CodecOptions& options)
+{
+    QByteArray avatar(200 * 1024, Qt::Uninitialized);
+    std::mt19937 rng(7);
+    for (char& byte : avatar)
+    {
+        byte = char(rng() & 0xff);
+    }
+
+    Scenario scenario{name, options, QJsonObject(), Attachments()};
+    scenario.json["tag"] = "login";
+    scenario.json["result"] = "success";
+    scenario.json["usernum"] = "100000005";
+    scenario.json["nickname"] = "测试用户";
+    scenario.attachments.insert("avatar_data", avatar);
+    return scenario;
+}
+
+// 指定大小的帧：Base64 字符串字段填充到 frameBytes 左右，模拟 v1 下内嵌的图片数据
+Scenario sizedScenario(const QString& name, const CodecOptions& options, int frameBytes)
+{
+    QByteArray filler(qMax(1, frameBytes * 3 / 4 - 64), Qt::Uninitialized);
+    std::mt19937 rng(11);
+    for (char& byte : filler)
+    {
+        byte = char(rng() & 0xff);
+    }
+
+    Scenario scenario{name, options, QJsonObject(), Attachments()};
+    scenario.json["tag"] = "face";
+    scenario.json["mode"] = "save";
+    scenario.json["usernum"] = "100000005";
+    scenario.json["face"] = QString::fromLatin1(filler.toBase64());
+    return scenario;
+}
+
+std::vector<QByteArray> splitStream(const QByteArray& stream)
+{
+    std::vector<QByteArray> chunks;
+    for (qsizetype offset = 0; offset < stream.size(); offset += CHUNK_SIZE)
+    {
+        chunks.push_back(stream.mid(offset, CHUNK_SIZE));
+    }
+    return chunks;
+}
+
+// 原来的做法：整体拼接，每次从头查找分隔符，取出后从缓冲区头部删除
+int legacyDecode(const std::vector<QByteArray>& chunks)
+{
+    QByteArray buffer;
+    int frames = 0;
+    for (const QByteArray& chunk : chunks)
+    {
+        buffer += chunk;
+        while (true)
+        {
+            const qsizetype endIndex = buffer.indexOf(FRAME_DELIMITER);
+            if (endIndex == -1)
+            {
+                break;
+            }
+            const QByteArray completeMessage = buffer.left(endIndex + FRAME_DELIMITER_SIZE - FRAME_TRAILER_SIZE);
+            buffer.remove(0, endIndex + FRAME_DELIMITER_SIZE);
+            ++frames;
+        }
+    }
+    return frames;
+}
+
+int incrementalDecode(const std::vector<QByteArray>& chunks, bool parse)
+{
+    FrameDecoder decoder;
+    Frame frame;
+    int frames = 0;
+    for (const QByteArray& chunk : chunks)
+    {
+        decoder.append(chunk);
+        while (decoder.nextFrame(frame))
+        {
+            if (parse)
+            {
+                Message message;
+                if (!FrameCodec::decode(frame, message))
+                {
+                    return -1;
+                }
+            }
+            ++frames;
+        }
+    }
+    return decoder.isCorrupted() ? -1 : frames;
+}
+
+// 吞吐（MB/s），帧数不对时返回负数
+template <typename Decode>
+double throughput(qint64 bytes, int expectedFrames, Decode decode)
+{
+    qint64 best = -1;
+    for (int run = 0; run < RUNS; ++run)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        const int frames = decode();
+        const qint64 elapsed = timer.nsecsElapsed();
+        if (frames != expectedFrames)
+        {
+            return -1.0;
+        }
+        if (best < 0 || elapsed < best)
+        {
+            best = elapsed;
+        }
+    }
+    return best > 0 ? bytes * 1e3 / best : 0.0;
+}
+
+QString formatRate(double rate)
+{
+    return rate < 0.0 ? QString("-") : QString::number(rate, 'f', 1);
+}
+} // namespace
+
+int FrameBenchmark::run(int megabytes)
+{
+    const qint64 streamBytes = qint64(qMax(1, megabytes)) * 1024 * 1024;
+
+    QJsonObject heartbeat;
+    heartbeat["tag"] = "heartbeat";
+    const CodecOptions v1;
+
+    const std::vector<Scenario> scenarios = {
+        {"v1 心跳", v1, heartbeat, Attachments()},
+        sizedScenario("v1 1KB", v1, 1024),
+        {"v1 赛事列表", v1, contestList(), Attachments()},
+        avatarScenario("v1 头像(Base64)", v1),
+        sizedScenario("v1 5MB", v1, 5 * 1024 * 1024),
+        {"v2 JSON 心跳", v2Options(FrameType::Json, Compression::None), heartbeat, Attachments()},
+        {"v2 CBOR 赛事列表", v2Options(FrameType::Cbor, Compression::None), contestList(), Attachments()},
+        {"v2 CBOR+zlib 赛事列表", v2Options(FrameType::Cbor, Compression::Zlib), contestList(), Attachments()},
+        avatarScenario("v2 头像附件", v2Options(FrameType::Cbor, Compression::None)),
+        sizedScenario("v2 JSON 1KB", v2Options(FrameType::Json, Compression::None), 1024),
+        sizedScenario("v2 JSON 5MB", v2Options(FrameType::Json, Compression::None), 5 * 1024 * 1024),
+    };
+
+    qInfo().noquote() << QString("每个场景约 %1 MB，按 %2 字节分块送入，取 %3 次中最快的一次").arg(megabytes).arg(CHUNK_SIZE).arg(RUNS);
+    qInfo().noquote() << "场景                    帧字节    帧数  旧解码MB/s  增量解码MB/s  含解析MB/s";
+
+    for (const Scenario& scenario : scenarios)
+    {
+        const QByteArray frame = FrameCodec::encode(scenario.json, scenario.options, scenario.attachments);
+        const int frameCount = int(qMax<qint64>(1, streamBytes / frame.size()));
+
+        QByteArray stream;
+        stream.reserve(qsizetype(frame.size()) * frameCount);
+        for (int i = 0; i < frameCount; ++i)
+        {
+            stream += frame;
+        }
+        const std::vector<QByteArray> chunks = splitStream(stream);
+
+        // 旧解码器只认识 v1 分隔符
+        const double legacy = scenario.options.version == PROTOCOL_V1
+                                  ? throughput(stream.size(), frameCount, [&chunks]() { return legacyDecode(chunks); })
+                                  : -1.0;
+        const double incremental = throughput(stream.size(), frameCount, [&chunks]() { return incrementalDecode(chunks, false); });
+        const double parsed = throughput(stream.size(), frameCount, [&chunks]() { return incrementalDecode(chunks, true); });
+
+        qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6")
+                                 .arg(scenario.name, -22)
+                                 .arg(frame.size(), 8)
+                                 .arg(frameCount, 7)
+                                 .arg(formatRate(legacy), 10)
+                                 .arg(formatRate(incremental), 12)
+                                 .arg(formatRate(parsed), 10);
+    }
+    return 0;
+}
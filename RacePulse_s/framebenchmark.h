@@ -0,0 +1,13 @@
+#ifndef FRAMEBENCHMARK_H
+#define FRAMEBENCHMARK_H
+
+// 帧解码吞吐对比，命令行运行：RacePulse_s --bench-decoder [每个场景的数据量 MB，默认 16]
+// 各类消息（含 1KB 与 5MB 的帧）按 v1 / v2（JSON、CBOR、压缩、附件）编码成连续字节流，按 TCP 报文段大小分块送入，
+// 输出原来的 indexOf + remove(0, n) 解码、增量帧解码器、以及解码后再解析消息的吞吐
+class FrameBenchmark
+{
+public:
+    static int run(int megabytes);
+};
+
+#endif // FRAMEBENCHMARK_H
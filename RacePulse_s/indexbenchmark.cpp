@@ -0,0 +1,151 @@
+#include "indexbenchmark.h"
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "faceindex.h"
+#include "facesimilarity.h"
+#include "qdebug.h"
+
+namespace
+{
+constexpr int DIM = 512;
+constexpr int QUERIES = 500;
+constexpr float NOISE = 0.04f; // 查询与所属模板的余弦相似度约 0.7，接近同一人的两次采集
+
+void normalize(float* row)
+{
+    double norm = 0.0;
+    for (int k = 0; k < DIM; ++k)
+    {
+        norm += double(row[k]) * row[k];
+    }
+    const float scale = float(1.0 / std::sqrt(norm));
+    for (int k = 0; k < DIM; ++k)
+    {
+        row[k] *= scale;
+    }
+}
+
+double percentile(std::vector<qint64> samples, int percent)
+{
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, samples.size() * percent / 100)] / 1e3;
+}
+
+double mean(const std::vector<qint64>& samples)
+{
+    return std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size() / 1e3;
+}
+
+// 在当前索引（前 userCount 个模板）上查询，输出一行结果
+void measure(FaceIndex& index, const std::vector<float>& templates, int userCount, double buildSeconds, std::mt19937& rng)
+{
+    std::normal_distribution<float> gaussian;
+
+    // 查询：从已建索引的模板中随机选一个加噪声
+    std::uniform_int_distribution<int> pick(0, userCount - 1);
+    std::vector<float> queries(size_t(QUERIES) * DIM);
+    for (int q = 0; q < QUERIES; ++q)
+    {
+        const float* source = templates.data() + size_t(pick(rng)) * DIM;
+        float* query = queries.data() + size_t(q) * DIM;
+        for (int k = 0; k < DIM; ++k)
+        {
+            query[k] = source[k] + NOISE * gaussian(rng);
+        }
+        normalize(query);
+    }
+
+    std::vector<qint64> hnswLatencies;
+    std::vector<qint64> linearLatencies;
+    int agreed = 0;
+    for (int q = 0; q < QUERIES; ++q)
+    {
+        const float* query = queries.data() + size_t(q) * DIM;
+
+        QElapsedTimer timer;
+        timer.start();
+        const QList<FaceIndex::Result> results = index.search(query, DIM, 1);
+        hnswLatencies.push_back(timer.nsecsElapsed());
+
+        timer.restart();
+        const FaceSimilarity::Match exact = FaceSimilarity::nearest(query, templates.data(), userCount, DIM);
+        linearLatencies.push_back(timer.nsecsElapsed());
+
+        if (!results.isEmpty() && results.first().usernum == QString::number(exact.index))
+        {
+            ++agreed;
+        }
+    }
+
+    const double hnswMean = mean(hnswLatencies);
+    const double linearMean = mean(linearLatencies);
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7 %8")
+                             .arg(userCount, 8)
+                             .arg(buildSeconds, 9, 'f', 1)
+                             .arg(linearMean, 11, 'f', 1)
+                             .arg(percentile(linearLatencies, 95), 10, 'f', 1)
+                             .arg(hnswMean, 10, 'f', 1)
+                             .arg(percentile(hnswLatencies, 95), 9, 'f', 1)
+                             .arg(hnswMean > 0.0 ? linearMean / hnswMean : 0.0, 7, 'f', 1)
+                             .arg(double(agreed) / QUERIES, 9, 'f', 3);
+}
+} // namespace
+
+int IndexBenchmark::run(int maxUsers)
+{
+    // 规模逐级增大，索引增量插入，到达每一级时测一次，不必每级重建
+    std::vector<int> checkpoints;
+    for (const int count : {10000, 100000, 1000000})
+    {
+        if (count <= maxUsers)
+        {
+            checkpoints.push_back(count);
+        }
+    }
+    if (checkpoints.empty() || checkpoints.back() != maxUsers)
+    {
+        checkpoints.push_back(maxUsers);
+    }
+
+    std::mt19937 rng(20240601);
+    std::normal_distribution<float> gaussian;
+
+    std::vector<float> templates(size_t(maxUsers) * DIM);
+    for (int i = 0; i < maxUsers; ++i)
+    {
+        float* row = templates.data() + size_t(i) * DIM;
+        std::generate(row, row + DIM, [&]() { return gaussian(rng); });
+        normalize(row);
+    }
+
+    qInfo().noquote() << QString("最多 %1 个用户，维度 %2，每级查询 %3 次，比对内核 %4").arg(maxUsers).arg(DIM).arg(QUERIES).arg(FaceSimilarity::kernelName());
+    qInfo().noquote() << "  用户数  建索引s  线性平均us  线性P95us  HNSW平均us  HNSW P95us   加速  recall@1";
+
+    // 命令行模式下没有打开特征库，索引为空，这里只放测试数据
+    FaceIndex& index = FaceIndex::getInstance();
+    index.clear();
+
+    QElapsedTimer buildTimer;
+    double buildSeconds = 0.0;
+    int inserted = 0;
+    for (const int checkpoint : checkpoints)
+    {
+        buildTimer.start();
+        for (; inserted < checkpoint; ++inserted)
+        {
+            index.add(QString::number(inserted), templates.data() + size_t(inserted) * DIM, DIM);
+        }
+        buildSeconds += buildTimer.nsecsElapsed() / 1e9;
+        measure(index, templates, checkpoint, buildSeconds, rng);
+    }
+    index.clear();
+    return 0;
+}
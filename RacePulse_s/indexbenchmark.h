@@ -0,0 +1,14 @@
+#ifndef INDEXBENCHMARK_H
+#define INDEXBENCHMARK_H
+
+// 1:N 识别检索对比，命令行运行：RacePulse_s --bench-index [最多用户数，默认 1000000]
+// 随机生成已归一化的 512 维模板，逐级增量建立 HNSW 索引，在 1 万、10 万、100 万（不超过最多用户数）时
+// 用加了噪声的模板查询，输出累计建索引耗时、HNSW 与线性扫描的单次查询延迟（平均、P95），以及 HNSW 的 recall@1；
+// 100 万个模板约需 4GB 内存（测试数据与索引各一份）
+class IndexBenchmark
+{
+public:
+    static int run(int maxUsers);
+};
+
+#endif // INDEXBENCHMARK_H
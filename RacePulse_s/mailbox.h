@@ -0,0 +1,68 @@
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+#include <utility>
+
+// 多生产者单消费者无锁队列（Vyukov MPSC）
+// 任意线程都可以 push，入队只有一次原子交换，不加锁也不会阻塞；
+// pop 只能由所属线程调用。生产者交换 head 与链接 next 之间的短暂间隙里
+// pop 可能返回 false，调用方需在下一次投递时重新调度消费
+template <typename T>
+class Mailbox
+{
+public:
+    Mailbox()
+        : head(new Node)
+        , tail(head.load(std::memory_order_relaxed))
+    {
+    }
+
+    ~Mailbox()
+    {
+        T value;
+        while (pop(value))
+        {
+        }
+        delete tail;
+    }
+
+    Mailbox(const Mailbox&) = delete;
+    Mailbox& operator=(const Mailbox&) = delete;
+
+    void push(T value)
+    {
+        Node* node = new Node;
+        node->value = std::move(value);
+
+        Node* prev = head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    bool pop(T& value)
+    {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next)
+        {
+            return false;
+        }
+
+        // next 成为新的哨兵节点，旧哨兵释放
+        value = std::move(next->value);
+        delete tail;
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next{nullptr};
+        T value;
+    };
+
+    alignas(64) std::atomic<Node*> head; // 生产者端
+    alignas(64) Node* tail;              // 消费者端，只在所属线程访问
+};
+
+#endif // MAILBOX_H
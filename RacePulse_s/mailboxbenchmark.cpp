@@ -0,0 +1,116 @@
+#include "mailboxbenchmark.h"
+
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+
+#include <atomic>
+#include <vector>
+
+#include "mailbox.h"
+#include "qdebug.h"
+
+namespace
+{
+struct LockFreeQueue
+{
+    Mailbox<QJsonObject> mailbox;
+
+    void push(const QJsonObject& message) { mailbox.push(message); }
+    bool pop(QJsonObject& message) { return mailbox.pop(message); }
+};
+
+// 对照：加锁队列
+struct LockedQueue
+{
+    QMutex mutex;
+    QQueue<QJsonObject> queue;
+
+    void push(const QJsonObject& message)
+    {
+        QMutexLocker locker(&mutex);
+        queue.enqueue(message);
+    }
+
+    bool pop(QJsonObject& message)
+    {
+        QMutexLocker locker(&mutex);
+        if (queue.isEmpty())
+        {
+            return false;
+        }
+        message = queue.dequeue();
+        return true;
+    }
+};
+
+// 吞吐（百万条/s），消费者在当前线程中忙等取出全部消息
+template <typename Queue>
+double throughput(int producerCount, int messageCount)
+{
+    Queue queue;
+    QJsonObject message;
+    message["tag"] = "push";
+    message["content"] = "赛事即将开始签到";
+
+    const int perProducer = messageCount / producerCount;
+    const int total = perProducer * producerCount;
+    std::atomic<bool> start{false};
+
+    std::vector<QThread*> producers;
+    for (int p = 0; p < producerCount; ++p)
+    {
+        producers.push_back(QThread::create([&queue, &start, &message, perProducer]()
+                                            {
+                                                while (!start.load(std::memory_order_acquire))
+                                                {
+                                                }
+                                                for (int i = 0; i < perProducer; ++i)
+                                                {
+                                                    queue.push(message);
+                                                }
+                                            }));
+        producers.back()->start();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    start.store(true, std::memory_order_release);
+
+    QJsonObject received;
+    for (int consumed = 0; consumed < total;)
+    {
+        if (queue.pop(received))
+        {
+            ++consumed;
+        }
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    for (QThread* producer : producers)
+    {
+        producer->wait();
+        delete producer;
+    }
+    return elapsed > 0 ? total * 1e3 / elapsed : 0.0;
+}
+} // namespace
+
+int MailboxBenchmark::run(int messageCount)
+{
+    qInfo().noquote() << QString("消息数 %1，CPU 线程数 %2").arg(messageCount).arg(QThread::idealThreadCount());
+    qInfo().noquote() << "生产者  Mailbox 百万条/s  QMutex+QQueue 百万条/s";
+
+    for (const int producers : {1, 2, 4, 8})
+    {
+        const double lockFree = throughput<LockFreeQueue>(producers, messageCount);
+        const double locked = throughput<LockedQueue>(producers, messageCount);
+        qInfo().noquote() << QString("%1 %2 %3")
+                                 .arg(producers, 6)
+                                 .arg(lockFree, 18, 'f', 2)
+                                 .arg(locked, 23, 'f', 2);
+    }
+    return 0;
+}
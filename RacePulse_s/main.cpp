@@ -1,9 +1,95 @@
 #include <QApplication>
+#include <QCoreApplication>
 
+#include "codecbenchmark.h"
+#include "connectionbenchmark.h"
+#include "embeddingbenchmark.h"
+#include "faceembeddingstore.h"
+#include "facepipelinebenchmark.h"
+#include "framebenchmark.h"
+#include "indexbenchmark.h"
+#include "mailboxbenchmark.h"
+#include "modelbenchmark.h"
 #include "server.h"
+#include "sessionbenchmark.h"
+#include "similaritybenchmark.h"
 
 int main(int argc, char* argv[])
 {
+    // 命令行工具，不启动界面
+    // RacePulse_s --compact-faces：离线压缩人脸特征库
+    // RacePulse_s --bench-embedding <目录>：对比推理后端与模型精度
+    // RacePulse_s --bench-face <目录>：人脸图片解码、检测、预处理与质量检查各阶段耗时
+    // RacePulse_s --bench-decoder [MB]：帧解码吞吐
+    // RacePulse_s --bench-similarity [模板数]：比对内核 SIMD 与标量实现对比
+    // RacePulse_s --bench-index [最多用户数]：1:N 检索 HNSW 与线性扫描在 1 万、10 万、100 万用户下的对比
+    // RacePulse_s --bench-mailbox [消息数]：跨线程信箱吞吐
+    // RacePulse_s --bench-sessions [次数]：在线会话表分片与单锁并发对比
+    // RacePulse_s --bench-connections [秒数]：空闲连接的线程数、内存与上下文切换
+    // RacePulse_s --bench-codec：搜索与登录应答的 JSON 与 CBOR 编码、压缩开销对比
+    // RacePulse_s --bench-models [连接数]：每连接加载级联模型与共享注册表的内存与接入耗时对比
+    for (int i = 1; i < argc; ++i)
+    {
+        // 可选的数值参数
+        const int amount = i + 1 < argc ? QByteArray(argv[i + 1]).toInt() : 0;
+
+        if (qstrcmp(argv[i], "--compact-faces") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return FaceEmbeddingStore::getInstance().compact() ? 0 : 1;
+        }
+        if (qstrcmp(argv[i], "--bench-embedding") == 0 && i + 1 < argc)
+        {
+            QCoreApplication app(argc, argv);
+            return EmbeddingBenchmark::run(QString::fromLocal8Bit(argv[i + 1]));
+        }
+        if (qstrcmp(argv[i], "--bench-face") == 0 && i + 1 < argc)
+        {
+            QCoreApplication app(argc, argv);
+            return FacePipelineBenchmark::run(QString::fromLocal8Bit(argv[i + 1]));
+        }
+        if (qstrcmp(argv[i], "--bench-decoder") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return FrameBenchmark::run(amount > 0 ? amount : 16);
+        }
+        if (qstrcmp(argv[i], "--bench-similarity") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return SimilarityBenchmark::run(amount > 0 ? amount : 100000);
+        }
+        if (qstrcmp(argv[i], "--bench-index") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return IndexBenchmark::run(amount > 0 ? amount : 1000000);
+        }
+        if (qstrcmp(argv[i], "--bench-mailbox") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return MailboxBenchmark::run(amount > 0 ? amount : 2000000);
+        }
+        if (qstrcmp(argv[i], "--bench-sessions") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return SessionBenchmark::run(amount > 0 ? amount : 1000000);
+        }
+        if (qstrcmp(argv[i], "--bench-connections") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return ConnectionBenchmark::run(amount > 0 ? amount : 10);
+        }
+        if (qstrcmp(argv[i], "--bench-codec") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return CodecBenchmark::run();
+        }
+        if (qstrcmp(argv[i], "--bench-models") == 0)
+        {
+            QCoreApplication app(argc, argv);
+            return ModelBenchmark::run(amount > 0 ? amount : 1000);
+        }
+    }
+
     QApplication a(argc, argv);
 
     Server w;
@@ -0,0 +1,131 @@
+#include "modelbenchmark.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSettings>
+#include <QThread>
+#include <opencv2/objdetect.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+#include "facemodelregistry.h"
+#include "qdebug.h"
+
+namespace
+{
+// 当前进程的常驻内存，读不到时为 -1
+qint64 rssKb()
+{
+#ifdef Q_OS_LINUX
+    QFile status("/proc/self/status");
+    if (status.open(QIODevice::ReadOnly))
+    {
+        for (const QByteArray& line : status.readAll().split('\n'))
+        {
+            if (line.startsWith("VmRSS:"))
+            {
+                return line.mid(6).trimmed().split(' ').first().toLongLong();
+            }
+        }
+    }
+#endif
+    return -1;
+}
+
+double percentileMs(std::vector<qint64> samples, int percent)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, samples.size() * percent / 100)] / 1e6;
+}
+
+QString perConnectionKb(qint64 beforeKb, qint64 afterKb, int connections)
+{
+    return beforeKb < 0 || afterKb < 0 ? QString("-") : QString::number(double(afterKb - beforeKb) / connections, 'f', 1);
+}
+} // namespace
+
+int ModelBenchmark::run(int connections)
+{
+    connections = qMax(1, connections);
+    const QString cascadePath = QSettings().value("face/cascade", "D:/Lib/OpenCV-MinGW-Build-OpenCV-4.5.5-x64/etc/haarcascades/haarcascade_frontalface_default.xml").toString();
+
+    // 原来的做法：每个连接构造时解析一次 XML，并一直持有自己的那份
+    std::vector<std::unique_ptr<cv::CascadeClassifier>> perConnection;
+    perConnection.reserve(size_t(connections));
+    std::vector<qint64> loadLatencies;
+    loadLatencies.reserve(size_t(connections));
+
+    const qint64 beforeStart = rssKb();
+    for (int i = 0; i < connections; ++i)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        std::unique_ptr<cv::CascadeClassifier> cascade(new cv::CascadeClassifier);
+        if (!cascade->load(cascadePath.toStdString()))
+        {
+            qWarning() << "无法加载级联模型:" << cascadePath;
+            return 1;
+        }
+        loadLatencies.push_back(timer.nsecsElapsed());
+        perConnection.push_back(std::move(cascade));
+    }
+    const qint64 beforeEnd = rssKb();
+    perConnection.clear();
+
+    // 现在的做法：启动时读入一次，连接接入时不碰模型，每个反应器线程第一次做人脸检测时从内存构建
+    FaceModelRegistry& registry = FaceModelRegistry::getInstance();
+    const qint64 afterStart = rssKb();
+    QElapsedTimer loadTimer;
+    loadTimer.start();
+    if (!registry.load())
+    {
+        qWarning() << "人脸模型注册表加载失败";
+        return 1;
+    }
+    const double registryMs = loadTimer.nsecsElapsed() / 1e6;
+
+    int reactors = QSettings().value("server/reactor_threads", 0).toInt();
+    if (reactors <= 0)
+    {
+        reactors = qMax(1, QThread::idealThreadCount());
+    }
+    std::vector<qint64> buildLatencies(size_t(reactors));
+    for (int i = 0; i < reactors; ++i)
+    {
+        // 线程结束后线程内的实例随之释放，因此测完内存再让线程退出
+        QThread* thread = QThread::create([&registry, &buildLatencies, i]()
+                                          {
+                                              QElapsedTimer timer;
+                                              timer.start();
+                                              registry.detector();
+                                              buildLatencies[size_t(i)] = timer.nsecsElapsed(); });
+        thread->start();
+        thread->wait();
+        delete thread;
+    }
+    const qint64 afterEnd = rssKb();
+
+    qInfo().noquote() << QString("连接数 %1，反应器线程 %2，模型 %3").arg(connections).arg(reactors).arg(cascadePath);
+    qInfo().noquote() << "做法          每连接内存KB  接入耗时P50ms  接入耗时P99ms  一次性耗时ms";
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5")
+                             .arg("每连接加载", -12)
+                             .arg(perConnectionKb(beforeStart, beforeEnd, connections), 13)
+                             .arg(percentileMs(loadLatencies, 50), 14, 'f', 3)
+                             .arg(percentileMs(loadLatencies, 99), 14, 'f', 3)
+                             .arg("-", 13);
+    // 接入时不再有模型相关的工作，一次性耗时为启动时读入加上各反应器线程首次构建
+    qInfo().noquote() << QString("%1 %2 %3 %4 %5")
+                             .arg("共享注册表", -12)
+                             .arg(perConnectionKb(afterStart, afterEnd, connections), 13)
+                             .arg(0.0, 14, 'f', 3)
+                             .arg(0.0, 14, 'f', 3)
+                             .arg(registryMs + std::accumulate(buildLatencies.begin(), buildLatencies.end(), 0.0) / 1e6, 13, 'f', 1);
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef MODELBENCHMARK_H
+#define MODELBENCHMARK_H
+
+// 检测模型加载方式对比，命令行运行：RacePulse_s --bench-models [连接数，默认 1000]
+// 原来每个 ClientHandler 构造时各自 load 一次 Haar 级联 XML，现在由 FaceModelRegistry 启动时读入一次、
+// 每个反应器线程从内存构建一份；输出两种做法下每个连接多占的内存（RSS）与接入时花在模型上的耗时
+class ModelBenchmark
+{
+public:
+    static int run(int connections);
+};
+
+#endif // MODELBENCHMARK_H
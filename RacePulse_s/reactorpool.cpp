@@ -0,0 +1,156 @@
+#include "reactorpool.h"
+
+#include <QSettings>
+
+#include <memory>
+
+#include "qdebug.h"
+
+Reactor::Reactor(int index)
+    : m_index(index)
+    , m_wheel(new TimingWheel(500, this))
+{
+}
+
+Reactor::~Reactor()
+{
+}
+
+int Reactor::index() const
+{
+    return m_index;
+}
+
+int Reactor::load() const
+{
+    return m_load.load(std::memory_order_relaxed);
+}
+
+void Reactor::attach()
+{
+    m_load.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Reactor::detach()
+{
+    m_load.fetch_sub(1, std::memory_order_relaxed);
+}
+
+TimingWheel* Reactor::timingWheel() const
+{
+    return m_wheel;
+}
+
+ReactorPool::ReactorPool(int threadCount, QObject* parent)
+    : QObject(parent)
+{
+    // 未指定时读取配置，默认每个核心一个反应器线程
+    if (threadCount <= 0)
+    {
+        threadCount = QSettings().value("server/reactor_threads", 0).toInt();
+    }
+    if (threadCount <= 0)
+    {
+        threadCount = qMax(1, QThread::idealThreadCount());
+    }
+
+    for (int i = 0; i < threadCount; ++i)
+    {
+        QThread* thread = new QThread(this);
+        thread->setObjectName(QString("Reactor_%1").arg(i));
+
+        Reactor* reactor = new Reactor(i);
+        reactor->moveToThread(thread);
+
+        threads.append(thread);
+        reactors.append(reactor);
+
+        thread->start();
+    }
+
+    qDebug() << "反应器线程数:" << threadCount;
+}
+
+ReactorPool::~ReactorPool()
+{
+    stop();
+}
+
+Reactor* ReactorPool::nextReactor()
+{
+    if (reactors.isEmpty())
+    {
+        return nullptr;
+    }
+
+    // 从轮询位置开始找负载最小的反应器，负载相同时自然退化为轮询
+    const int count = reactors.size();
+    Reactor* best = nullptr;
+    for (int i = 0; i < count; ++i)
+    {
+        Reactor* reactor = reactors[(roundRobin + i) % count];
+        if (!best || reactor->load() < best->load())
+        {
+            best = reactor;
+        }
+    }
+    roundRobin = (best->index() + 1) % count;
+
+    return best;
+}
+
+void ReactorPool::runOnEach(const std::function<void()>& task, const std::function<void()>& done)
+{
+    if (reactors.isEmpty())
+    {
+        if (done)
+        {
+            done();
+        }
+        return;
+    }
+
+    auto remaining = std::make_shared<std::atomic<int>>(int(reactors.size()));
+    for (Reactor* reactor : std::as_const(reactors))
+    {
+        QMetaObject::invokeMethod(reactor, [task, done, remaining]()
+                                  {
+                                      task();
+                                      if (remaining->fetch_sub(1) == 1 && done)
+                                      {
+                                          done();
+                                      } }, Qt::QueuedConnection);
+    }
+}
+
+int ReactorPool::threadCount() const
+{
+    return threads.size();
+}
+
+int ReactorPool::totalLoad() const
+{
+    int total = 0;
+    for (const Reactor* reactor : reactors)
+    {
+        total += reactor->load();
+    }
+    return total;
+}
+
+void ReactorPool::stop()
+{
+    for (QThread* thread : threads)
+    {
+        thread->quit();
+    }
+    for (QThread* thread : threads)
+    {
+        thread->wait();
+    }
+
+    // 线程已退出，反应器可以在当前线程直接释放
+    qDeleteAll(reactors);
+    reactors.clear();
+    threads.clear();
+}
@@ -0,0 +1,59 @@
+#ifndef REACTORPOOL_H
+#define REACTORPOOL_H
+
+#include <QList>
+#include <QObject>
+#include <QThread>
+
+#include <atomic>
+#include <functional>
+
+#include "timingwheel.h"
+
+// I/O 反应器：一个线程 + 一个事件循环，复用承载多个 ClientHandler
+class Reactor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Reactor(int index);
+    ~Reactor();
+
+    int index() const;
+    int load() const; // 当前承载的连接数
+
+    void attach();
+    void detach();
+
+    TimingWheel* timingWheel() const; // 本线程所有连接共用的心跳时间轮
+
+private:
+    int m_index;
+    TimingWheel* m_wheel;
+    std::atomic<int> m_load{0};
+};
+
+// 固定数量的反应器线程，新连接按最小负载（负载相同则轮询）分配
+class ReactorPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ReactorPool(int threadCount = 0, QObject* parent = nullptr);
+    ~ReactorPool();
+
+    Reactor* nextReactor();
+    // 在每个反应器线程中各执行一次，不等待完成；done 在最后一个完成的反应器线程中调用
+    void runOnEach(const std::function<void()>& task, const std::function<void()>& done = nullptr);
+    int threadCount() const;
+    int totalLoad() const;
+
+    void stop();
+
+private:
+    QList<QThread*> threads;
+    QList<Reactor*> reactors;
+    int roundRobin = 0;
+};
+
+#endif // REACTORPOOL_H
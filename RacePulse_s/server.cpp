@@ -2,8 +2,19 @@
 
 #include <ClientHandler.h>
 
+#include <QMessageBox>
+#include <QSettings>
 #include <QSqlQueryModel>
+#include <QTimer>
 
+#include <atomic>
+#include <memory>
+
+#include "faceembeddingstore.h"
+#include "faceinferencepool.h"
+#include "facemetrics.h"
+#include "facemodelregistry.h"
+#include "facesimilarity.h"
 #include "qjsonobject.h"
 #include "ui_server.h"
 
@@ -21,16 +32,51 @@ Server::Server(QWidget* parent)
     databaseConnect();
     on_pu_refresh_table_clicked();
 
-    // 设置全局线程池
-    // 避免多次创建 浪费系统资源
-    // threadPool = QThreadPool::globalInstance();
-    // int maxThreads = QThread::idealThreadCount() * 2;
-    // threadPool->setMaxThreadCount(qMin(maxThreads, 300));
+    // 人脸模型进程内只加载一次，所有连接共用
+    if (!FaceModelRegistry::getInstance().load())
+    {
+        QMessageBox::critical(this, "Error", "Failed to load face models.");
+    }
+
+    // 人脸特征库，首次启动时把旧的 YAML 特征迁移为二进制格式
+    FaceEmbeddingStore::getInstance().open();
+    qDebug() << "人脸比对内核:" << FaceSimilarity::kernelName();
+
+    // 人脸特征提取在独立的推理线程中批量执行
+    FaceInferencePool::getInstance().start();
+
+    // 定期输出人脸处理各阶段耗时
+    QTimer* metricsTimer = new QTimer(this);
+    connect(metricsTimer, &QTimer::timeout, this, []()
+            { qDebug() << "人脸处理耗时:" << FaceMetrics::getInstance().summary(); });
+    metricsTimer->start(qMax(1, QSettings().value("face/metrics_interval_s", 60).toInt()) * 1000);
+
+    // 签到窗口内参赛者的人脸特征常驻内存
+    contestPreloader = new ContestPreloader(this);
+    contestPreloader->start();
+
+    // 固定数量的反应器线程，所有连接复用这些线程的事件循环
+    // 避免每个连接一个线程 浪费系统资源
+    reactorPool = new ReactorPool(0, this);
+
+    // 模型在各线程构建并预热完成前不开启监听，首个请求不再承担模型构建开销
+    ui->pu_listen->setEnabled(false);
+    ui->pu_reload_model->setEnabled(false);
+    warmUpModels();
 }
 
 Server::~Server()
 {
-    // threadPool->waitForDone();
+    if (modelLoader)
+    {
+        modelLoader->wait();
+    }
+    contestPreloader->stop();
+    // 先停推理线程，避免回调投递到正在退出的反应器
+    FaceInferencePool::getInstance().stop();
+    activeHandlers.clear();
+    sessions.clear();
+    reactorPool->stop();
     delete ui;
 }
 
@@ -70,42 +116,54 @@ void Server::onNewConnection()
 
     ConnectionPool& pool = ConnectionPool::getInstance();
 
-    // 创建 handler 并保存引用
-    auto handler = std::make_shared<ClientHandler>(socket, pool, this);
-    activeHandlers.append(handler);
-
-    // 将 socket 移动到新线程
-    QThread* thread = new QThread(this);
-    socket->moveToThread(thread);
-    handler->moveToThread(thread);
+    // 选择负载最小的反应器
+    Reactor* reactor = reactorPool->nextReactor();
 
-    // 在移动到新线程后建立连接
-    connect(thread, &QThread::started, [handler, socket]()
-            {
-                // 在正确的线程上下文中建立连接
-                connect(socket, &QTcpSocket::readyRead,
-                        handler.get(), &ClientHandler::onReadyRead,
-                        Qt::QueuedConnection);
-                connect(socket, &QTcpSocket::disconnected,
-                        handler.get(), &ClientHandler::onDisconnected,
-                        Qt::QueuedConnection);
-                connect(socket, &QTcpSocket::errorOccurred,
-                        handler.get(), &ClientHandler::handleSocketError,
-                        Qt::QueuedConnection); });
-
-    // 处理清理
-    connect(socket, &QTcpSocket::disconnected, [this, handler, thread, socket]()
+    // 创建 handler 并保存引用
+    // handler 属于反应器线程，最后一个引用释放时交给该线程的事件循环销毁
+    auto handler = std::shared_ptr<ClientHandler>(new ClientHandler(socket, pool, this),
+                                                  [](ClientHandler* h) { h->deleteLater(); });
+    activeHandlers.insert(handler.get(), handler);
+    reactor->attach();
+
+    // 先在主线程完成全部连接，再移动到反应器线程，避免移动后漏掉已经发出的信号
+    // 信号在反应器线程发出，与 handler 同线程，直接调用
+    connect(socket, &QTcpSocket::readyRead, handler.get(), &ClientHandler::onReadyRead);
+    connect(socket, &QTcpSocket::disconnected, handler.get(), &ClientHandler::onDisconnected);
+    connect(socket, &QTcpSocket::errorOccurred, handler.get(), &ClientHandler::handleSocketError);
+
+    // 处理清理，回到主线程修改 activeHandlers；断开、出错、socket 销毁都可能是最后一个信号，只释放一次
+    ClientHandler* key = handler.get();
+    auto released = std::make_shared<bool>(false);
+    auto release = [this, key, reactor, released]()
+    {
+        if (*released)
+        {
+            return;
+        }
+        *released = true;
+
+        // 从活动处理器列表中移除
+        activeHandlers.remove(key);
+        reactor->detach();
+    };
+    connect(socket, &QTcpSocket::disconnected, this, release);
+    connect(socket, &QObject::destroyed, this, release);
+    connect(socket, &QTcpSocket::errorOccurred, this, [release](QAbstractSocket::SocketError error)
             {
-                // 从活动处理器列表中移除
-                activeHandlers.removeOne(handler);
-
-                // 清理线程和socket
-                socket->deleteLater();
-                thread->quit();
-                thread->wait();
-                thread->deleteLater(); });
-
-    thread->start();
+                // 超时时 handler 会尝试重连，连接仍然有效
+                if (error != QAbstractSocket::SocketTimeoutError)
+                {
+                    release();
+                } });
+
+    // socket 是 handler 的子对象，随 handler 一起移动到反应器线程
+    handler->moveToThread(reactor->thread());
+
+    // 心跳挂到反应器的时间轮上，需在反应器线程中注册
+    TimingWheel* wheel = reactor->timingWheel();
+    QMetaObject::invokeMethod(handler.get(), [h = handler.get(), wheel]()
+                              { h->attachTimingWheel(wheel); }, Qt::QueuedConnection);
 }
 bool Server::databaseConnect()
 {
@@ -148,40 +206,46 @@ void Server::showtable(const QString& tablename)
     ui->tableView->setModel(model);
 }
 
-void Server::addClient(const QString& account, std::shared_ptr<ClientHandler> handler)
+std::shared_ptr<ClientHandler> Server::addClient(const QString& account, std::shared_ptr<ClientHandler> handler)
 {
-    QMutexLocker locker(&mutex);
-    clientsMap.insert(account, handler);
+    return sessions.insert(account, std::move(handler));
 }
 
-void Server::removeClient(const QString& account)
+void Server::removeClient(const QString& account, const ClientHandler* handler)
 {
-    QMutexLocker locker(&mutex);
-    clientsMap.remove(account);
+    sessions.remove(account, handler);
 }
 
 std::shared_ptr<ClientHandler> Server::getClient(const QString& account)
 {
-    QMutexLocker locker(&mutex);
-    return clientsMap.value(account);
+    return sessions.find(account);
+}
+
+bool Server::pushToClient(const QString& account, const QJsonObject& message)
+{
+    auto handler = sessions.find(account);
+    if (!handler)
+    {
+        return false;
+    }
+    handler->post(message);
+    return true;
 }
 
 void Server::notifyClientsAndClose()
 {
     QJsonObject shutdownMessage;
-    shutdownMessage["tag"] = "client";
-    shutdownMessage["type"] = "server_shutdown";
+    shutdownMessage["tag"] = "server_shutdown";
     shutdownMessage["message"] = "Server is shutting down";
 
-    for (auto& handler : clientsMap)
+    // 只投递到各连接的信箱，由各自的反应器线程发送通知并断开，主线程不碰 socket
+    // 未登录的连接也要通知，遍历全部活动连接
+    for (auto it = activeHandlers.cbegin(); it != activeHandlers.cend(); ++it)
     {
-        if (handler)
-        {
-            handler->notifyClientShutdown(shutdownMessage);
-        }
+        it.value()->post(shutdownMessage);
     }
 
-    clientsMap.clear();
+    sessions.clear();
 }
 
 void Server::on_pu_listen_clicked()
@@ -234,21 +298,9 @@ void Server::on_pu_listen_clicked()
             "    background-color: #d32f2f;" // 按下时更深的红色
             "}");
 
-        // 关闭服务器前通知客户端
+        // 关闭服务器前通知客户端，各连接收到通知后自行断开
         notifyClientsAndClose();
 
-        // 逐一断开客户端连接
-        for (auto& handler : clientsMap)
-        {
-            if (handler)
-            {
-                handler->onDisconnected();
-            }
-        }
-
-        // 清空客户端映射
-        clientsMap.clear();
-
         // 关闭服务器逻辑
         if (TCP)
         {
@@ -261,6 +313,72 @@ void Server::on_pu_listen_clicked()
     }
 }
 
+void Server::warmUpModels()
+{
+    warmUpTimer.start();
+
+    // 反应器线程与推理线程都预热完成后回到主线程
+    auto remaining = std::make_shared<std::atomic<int>>(2);
+    auto finished = [this, remaining]()
+    {
+        if (remaining->fetch_sub(1) == 1)
+        {
+            QMetaObject::invokeMethod(this, [this]()
+                                      { onModelsWarmedUp(); }, Qt::QueuedConnection);
+        }
+    };
+
+    // 反应器线程负责人脸检测，各自构建检测模型
+    reactorPool->runOnEach([]()
+                           { FaceModelRegistry::getInstance().prepareDetectors(); }, finished);
+
+    // 推理线程各自构建特征模型并推理一次
+    if (!FaceInferencePool::getInstance().warmUp(finished))
+    {
+        finished();
+    }
+}
+
+void Server::onModelsWarmedUp()
+{
+    // 新模型已在各线程构建好，此时再切换，之后的请求直接使用新实例
+    FaceModelRegistry::getInstance().publish();
+    qDebug() << "人脸模型预热完成，版本" << FaceModelRegistry::getInstance().generation() << "耗时" << warmUpTimer.elapsed() << "ms";
+    ui->pu_listen->setEnabled(true);
+    ui->pu_reload_model->setEnabled(true);
+}
+
+void Server::on_pu_reload_model_clicked()
+{
+    if (modelLoader)
+    {
+        return;
+    }
+    ui->pu_reload_model->setEnabled(false);
+
+    // 在后台线程读取并校验新模型，校验通过后先预热再切换；切换前的请求继续使用旧模型
+    modelLoader = QThread::create([this]()
+                                  {
+                                      const bool staged = FaceModelRegistry::getInstance().stage();
+                                      QMetaObject::invokeMethod(this, [this, staged]()
+                                                                { onModelReloaded(staged); }, Qt::QueuedConnection); });
+    connect(modelLoader, &QThread::finished, modelLoader, &QObject::deleteLater);
+    modelLoader->start();
+}
+
+void Server::onModelReloaded(bool staged)
+{
+    if (!staged)
+    {
+        QMessageBox::warning(this, "Error", "新人脸模型加载失败，继续使用当前模型");
+        ui->pu_reload_model->setEnabled(true);
+        return;
+    }
+
+    // 各线程先构建新版本，全部完成后在 onModelsWarmedUp 中切换
+    warmUpModels();
+}
+
 void Server::on_pu_refresh_table_clicked()
 {
     on_combo_table_currentIndexChanged(ui->combo_table->currentIndex());
@@ -4,13 +4,19 @@
 #include <ConnectionPool.h>
 #include <QSqlDatabase.h>
 
+#include <QElapsedTimer>
+#include <QPointer>
 #include <QTcpServer>
 #include <QTcpSocket>
+#include <QThread>
 #include <QThreadPool>
 #include <QWidget>
 
 #include "clienthandler.h"
+#include "contestpreloader.h"
 #include "qmutex.h"
+#include "reactorpool.h"
+#include "sessionregistry.h"
 
 const qint16 port = 10086;
 
@@ -42,24 +48,34 @@ private slots:
 
     void on_combo_table_currentIndexChanged(int index);
 
+    void on_pu_reload_model_clicked();
+
 public:
-    QHash<QString, std::shared_ptr<ClientHandler>> clientsMap; // 存储账号与ClientHandler的映射 共享资源
-    QList<std::shared_ptr<ClientHandler>> activeHandlers;
+    SessionRegistry sessions; // 存储账号与ClientHandler的映射 共享资源，分片加锁
+    QHash<ClientHandler*, std::shared_ptr<ClientHandler>> activeHandlers; // 只在主线程访问
 
     void notifyClientsAndClose();
 
-    void addClient(const QString& account, std::shared_ptr<ClientHandler> handler);
-    void removeClient(const QString& account);
+    std::shared_ptr<ClientHandler> addClient(const QString& account, std::shared_ptr<ClientHandler> handler);
+    void removeClient(const QString& account, const ClientHandler* handler);
     std::shared_ptr<ClientHandler> getClient(const QString& account);
+    bool pushToClient(const QString& account, const QJsonObject& message); // 投递到在线用户的信箱
 
 private:
-    Ui::Server* ui;
+    void warmUpModels();     // 各线程构建人脸模型（有待切换版本时构建新版本）并推理一次
+    void onModelsWarmedUp(); // 预热完成后切换到新版本
+    void onModelReloaded(bool staged);
 
-    QMutex mutex;
+private:
+    Ui::Server* ui;
 
     QSqlDatabase db;
 
     // QThreadPool* threadPool;
+    ReactorPool* reactorPool; // 固定数量的 I/O 反应器线程
+    ContestPreloader* contestPreloader; // 赛事开始前预热参赛者人脸特征
+    QElapsedTimer warmUpTimer;          // 本次模型预热的耗时
+    QPointer<QThread> modelLoader;      // 后台加载新模型的线程
     bool listenFlag = false;
     QTcpServer* TCP;
 };
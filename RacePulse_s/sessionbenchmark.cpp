@@ -0,0 +1,172 @@
+#include "sessionbenchmark.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "qdebug.h"
+#include "sessionregistry.h"
+
+namespace
+{
+constexpr int ONLINE_USERS = 10000; // 常驻在线的账号
+constexpr int LOOKUPS = 4;          // 每次登录登出之间查询在线账号的次数
+
+// 只比较指针，不需要真正的 ClientHandler：用不持有对象的 shared_ptr 标记每个线程
+std::shared_ptr<ClientHandler> handlerTag(int thread)
+{
+    static char tags[64];
+    return std::shared_ptr<ClientHandler>(std::shared_ptr<ClientHandler>(), reinterpret_cast<ClientHandler*>(tags + thread));
+}
+
+struct ShardedSessions
+{
+    SessionRegistry registry;
+
+    void insert(const QString& usernum, const std::shared_ptr<ClientHandler>& handler) { registry.insert(usernum, handler); }
+    void remove(const QString& usernum, const ClientHandler* handler) { registry.remove(usernum, handler); }
+    bool find(const QString& usernum) const { return registry.find(usernum) != nullptr; }
+};
+
+// 对照：原来 Server 的 clientsMap，一把 QMutex 保护整张表
+struct LockedSessions
+{
+    mutable QMutex mutex;
+    QHash<QString, std::shared_ptr<ClientHandler>> sessions;
+
+    void insert(const QString& usernum, const std::shared_ptr<ClientHandler>& handler)
+    {
+        QMutexLocker locker(&mutex);
+        sessions.insert(usernum, handler);
+    }
+
+    void remove(const QString& usernum, const ClientHandler* handler)
+    {
+        QMutexLocker locker(&mutex);
+        auto it = sessions.find(usernum);
+        if (it != sessions.end() && it->get() == handler)
+        {
+            sessions.erase(it);
+        }
+    }
+
+    bool find(const QString& usernum) const
+    {
+        QMutexLocker locker(&mutex);
+        return sessions.value(usernum) != nullptr;
+    }
+};
+
+QStringList accounts(const QString& prefix, int count)
+{
+    QStringList list;
+    list.reserve(count);
+    for (int i = 0; i < count; ++i)
+    {
+        list.append(QString("%1%2").arg(prefix).arg(100000000 + i));
+    }
+    return list;
+}
+
+// 吞吐（百万次操作/s），每次登录登出计 2 + LOOKUPS 次操作
+template <typename Sessions>
+double throughput(int threadCount, int cycles, const QStringList& online)
+{
+    Sessions sessions;
+    const std::shared_ptr<ClientHandler> resident = handlerTag(63);
+    for (const QString& usernum : online)
+    {
+        sessions.insert(usernum, resident);
+    }
+
+    // 每个线程登录登出自己的一组账号，查询的是公共在线账号
+    std::vector<QStringList> churn;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        churn.push_back(accounts(QString("t%1_").arg(t), 1024));
+    }
+
+    const int perThread = cycles / threadCount;
+    std::atomic<bool> start{false};
+    std::atomic<int> ready{0};
+
+    std::vector<QThread*> workers;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        workers.push_back(QThread::create([&sessions, &start, &ready, &online, &churn, t, perThread]()
+                                          {
+                                              const std::shared_ptr<ClientHandler> handler = handlerTag(t);
+                                              const QStringList& own = churn[t];
+                                              quint32 seed = 2654435761u * quint32(t + 1);
+                                              int found = 0;
+                                              ready.fetch_add(1, std::memory_order_release);
+                                              while (!start.load(std::memory_order_acquire))
+                                              {
+                                              }
+                                              for (int i = 0; i < perThread; ++i)
+                                              {
+                                                  const QString& usernum = own[i & 1023];
+                                                  sessions.insert(usernum, handler);
+                                                  for (int l = 0; l < LOOKUPS; ++l)
+                                                  {
+                                                      seed = seed * 1664525u + 1013904223u;
+                                                      found += sessions.find(online[int(seed % quint32(online.size()))]);
+                                                  }
+                                                  sessions.remove(usernum, handler.get());
+                                              }
+                                              if (found != perThread * LOOKUPS)
+                                              {
+                                                  qWarning() << "在线账号查询结果不对:" << found;
+                                              } }));
+        workers.back()->start();
+    }
+    while (ready.load(std::memory_order_acquire) < threadCount)
+    {
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    start.store(true, std::memory_order_release);
+    for (QThread* worker : workers)
+    {
+        worker->wait();
+    }
+    const qint64 elapsed = timer.nsecsElapsed();
+
+    for (QThread* worker : workers)
+    {
+        delete worker;
+    }
+    const double operations = double(perThread) * threadCount * (2 + LOOKUPS);
+    return elapsed > 0 ? operations * 1e3 / elapsed : 0.0;
+}
+} // namespace
+
+int SessionBenchmark::run(int cycles)
+{
+    const QStringList online = accounts("", ONLINE_USERS);
+
+    qInfo().noquote() << QString("在线账号 %1，每种线程数共登录登出 %2 次，每次之间查询 %3 次，CPU 线程数 %4")
+                             .arg(ONLINE_USERS)
+                             .arg(cycles)
+                             .arg(LOOKUPS)
+                             .arg(QThread::idealThreadCount());
+    qInfo().noquote() << "线程  SessionRegistry 百万次/s  QMutex+QHash 百万次/s";
+
+    for (const int threads : {1, 2, 4, 8, 16})
+    {
+        const double sharded = throughput<ShardedSessions>(threads, cycles, online);
+        const double locked = throughput<LockedSessions>(threads, cycles, online);
+        qInfo().noquote() << QString("%1 %2 %3")
+                                 .arg(threads, 4)
+                                 .arg(sharded, 25, 'f', 2)
+                                 .arg(locked, 22, 'f', 2);
+    }
+    return 0;
+}
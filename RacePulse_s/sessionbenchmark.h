@@ -0,0 +1,13 @@
+#ifndef SESSIONBENCHMARK_H
+#define SESSIONBENCHMARK_H
+
+// 在线会话表并发对比，命令行运行：RacePulse_s --bench-sessions [每种线程数下的登录登出次数，默认 1000000]
+// 表中先登记 10000 个在线账号，1、2、4、8、16 个线程各自反复登录、查询在线账号（每次 4 个）、登出，
+// 输出分片 SessionRegistry 与原来的 QMutex + QHash 的吞吐（百万次操作/s）
+class SessionBenchmark
+{
+public:
+    static int run(int cycles);
+};
+
+#endif // SESSIONBENCHMARK_H
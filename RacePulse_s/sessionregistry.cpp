@@ -0,0 +1,87 @@
+#include "sessionregistry.h"
+
+SessionRegistry::SessionRegistry(int shardCount)
+{
+    // 分片数取 2 的幂，用掩码代替取模
+    int count = 1;
+    while (count < shardCount)
+    {
+        count <<= 1;
+    }
+    shards.reset(new Shard[count]);
+    shardMask = count - 1;
+}
+
+SessionRegistry::~SessionRegistry()
+{
+}
+
+std::shared_ptr<ClientHandler> SessionRegistry::insert(const QString& usernum, std::shared_ptr<ClientHandler> handler)
+{
+    Shard& shard = shardFor(usernum);
+    QWriteLocker locker(&shard.lock);
+
+    std::shared_ptr<ClientHandler> previous = shard.sessions.value(usernum);
+    shard.sessions.insert(usernum, std::move(handler));
+    return previous;
+}
+
+bool SessionRegistry::remove(const QString& usernum, const ClientHandler* handler)
+{
+    Shard& shard = shardFor(usernum);
+    QWriteLocker locker(&shard.lock);
+
+    auto it = shard.sessions.find(usernum);
+    if (it == shard.sessions.end() || it->get() != handler)
+    {
+        return false;
+    }
+    shard.sessions.erase(it);
+    return true;
+}
+
+std::shared_ptr<ClientHandler> SessionRegistry::find(const QString& usernum) const
+{
+    Shard& shard = shardFor(usernum);
+    QReadLocker locker(&shard.lock);
+    return shard.sessions.value(usernum);
+}
+
+QList<std::shared_ptr<ClientHandler>> SessionRegistry::snapshot() const
+{
+    QList<std::shared_ptr<ClientHandler>> handlers;
+    for (int i = 0; i <= shardMask; ++i)
+    {
+        QReadLocker locker(&shards[i].lock);
+        for (const auto& handler : shards[i].sessions)
+        {
+            handlers.append(handler);
+        }
+    }
+    return handlers;
+}
+
+int SessionRegistry::size() const
+{
+    int total = 0;
+    for (int i = 0; i <= shardMask; ++i)
+    {
+        QReadLocker locker(&shards[i].lock);
+        total += shards[i].sessions.size();
+    }
+    return total;
+}
+
+void SessionRegistry::clear()
+{
+    for (int i = 0; i <= shardMask; ++i)
+    {
+        QWriteLocker locker(&shards[i].lock);
+        shards[i].sessions.clear();
+    }
+}
+
+SessionRegistry::Shard& SessionRegistry::shardFor(const QString& usernum) const
+{
+    return shards[qHash(usernum) & shardMask];
+}
@@ -0,0 +1,47 @@
+#ifndef SESSIONREGISTRY_H
+#define SESSIONREGISTRY_H
+
+#include <QHash>
+#include <QList>
+#include <QReadWriteLock>
+#include <QString>
+
+#include <memory>
+
+class ClientHandler;
+
+// 在线会话表：账号 -> ClientHandler
+// 按账号哈希分片，每个分片独立的读写锁，登录、登出与查询只锁一个分片；
+// 查询只取读锁，不同账号之间互不阻塞
+class SessionRegistry
+{
+public:
+    explicit SessionRegistry(int shardCount = 64);
+    ~SessionRegistry();
+
+    // 登记会话，返回该账号原有的会话（重复登录时用于踢下线）
+    std::shared_ptr<ClientHandler> insert(const QString& usernum, std::shared_ptr<ClientHandler> handler);
+
+    // 只有登记的仍是该 handler 时才移除，避免旧连接断开时误删新会话
+    bool remove(const QString& usernum, const ClientHandler* handler);
+
+    std::shared_ptr<ClientHandler> find(const QString& usernum) const;
+    QList<std::shared_ptr<ClientHandler>> snapshot() const;
+    int size() const;
+    void clear();
+
+private:
+    // 每个分片独占缓存行，避免相邻分片的锁互相干扰
+    struct alignas(64) Shard
+    {
+        mutable QReadWriteLock lock;
+        QHash<QString, std::shared_ptr<ClientHandler>> sessions;
+    };
+
+    Shard& shardFor(const QString& usernum) const;
+
+    std::unique_ptr<Shard[]> shards;
+    int shardMask;
+};
+
+#endif // SESSIONREGISTRY_H
@@ -0,0 +1,114 @@
+#include "similaritybenchmark.h"
+
+#include <QElapsedTimer>
+#include <QString>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "facesimilarity.h"
+#include "qdebug.h"
+
+namespace
+{
+constexpr int DIM = 512;
+constexpr int PROBES = 32;
+constexpr int CACHED_TEMPLATES = 1000; // 约 2MB，留在缓存中
+constexpr qint64 MIN_COMPARISONS = 4000000; // 每项至少比对的次数，模板少时重复多轮，计时才稳定
+
+void randomUnitVectors(std::mt19937& rng, int count, std::vector<float>& out)
+{
+    std::normal_distribution<float> gaussian;
+    out.resize(size_t(count) * DIM);
+    for (int i = 0; i < count; ++i)
+    {
+        float* row = out.data() + size_t(i) * DIM;
+        double norm = 0.0;
+        for (int k = 0; k < DIM; ++k)
+        {
+            row[k] = gaussian(rng);
+            norm += double(row[k]) * row[k];
+        }
+        const float scale = float(1.0 / std::sqrt(norm));
+        for (int k = 0; k < DIM; ++k)
+        {
+            row[k] *= scale;
+        }
+    }
+}
+} // namespace
+
+int SimilarityBenchmark::run(int templateCount)
+{
+    std::mt19937 rng(20240601);
+    std::vector<float> templates;
+    std::vector<float> probes;
+    randomUnitVectors(rng, qMax(CACHED_TEMPLATES, templateCount), templates);
+    randomUnitVectors(rng, PROBES, probes);
+
+    qInfo().noquote() << QString("维度 %1，探针 %2 个，当前使用的实现: %3").arg(DIM).arg(PROBES).arg(FaceSimilarity::kernelName());
+    qInfo().noquote() << "模板数    实现      ns/次    ns/模板    GB/s  相对标量  结果一致";
+
+    // 1 与 10 对应 1:1 验证时每个用户 K 个模板的情况，调用本身的开销占主要部分
+    std::vector<int> counts = {1, 10, CACHED_TEMPLATES};
+    if (templateCount != CACHED_TEMPLATES)
+    {
+        counts.push_back(templateCount);
+    }
+
+    for (const int count : counts)
+    {
+        const int rounds = int(qMax<qint64>(1, MIN_COMPARISONS / (qint64(PROBES) * count)));
+
+        // 标量实现作为基准
+        std::vector<int> expected(PROBES, -1);
+        double scalarNs = 0.0;
+
+        for (const char* kernel : {"scalar", "avx2", "avx512"})
+        {
+            FaceSimilarity::Match match{0.0f, -1};
+            if (!FaceSimilarity::nearestWith(kernel, probes.data(), templates.data(), 1, DIM, match))
+            {
+                continue; // CPU 不支持
+            }
+
+            // 先跑一遍预热，并记录结果
+            std::vector<int> indices(PROBES, -1);
+            for (int p = 0; p < PROBES; ++p)
+            {
+                FaceSimilarity::nearestWith(kernel, probes.data() + size_t(p) * DIM, templates.data(), count, DIM, match);
+                indices[p] = match.index;
+            }
+
+            QElapsedTimer timer;
+            timer.start();
+            for (int round = 0; round < rounds; ++round)
+            {
+                for (int p = 0; p < PROBES; ++p)
+                {
+                    FaceSimilarity::nearestWith(kernel, probes.data() + size_t(p) * DIM, templates.data(), count, DIM, match);
+                }
+            }
+            const double nsPerCall = double(timer.nsecsElapsed()) / (double(PROBES) * rounds);
+            const double nsPerTemplate = nsPerCall / count;
+            const double gigabytesPerSecond = DIM * sizeof(float) / nsPerTemplate;
+
+            if (qstrcmp(kernel, "scalar") == 0)
+            {
+                expected = indices;
+                scalarNs = nsPerTemplate;
+            }
+
+            qInfo().noquote() << QString("%1 %2 %3 %4 %5 %6 %7")
+                                     .arg(count, -9)
+                                     .arg(kernel, -8)
+                                     .arg(nsPerCall, 9, 'f', 1)
+                                     .arg(nsPerTemplate, 9, 'f', 2)
+                                     .arg(gigabytesPerSecond, 7, 'f', 2)
+                                     .arg(nsPerTemplate > 0.0 ? scalarNs / nsPerTemplate : 0.0, 8, 'f', 2)
+                                     .arg(indices == expected ? "是" : "否");
+        }
+    }
+    return 0;
+}
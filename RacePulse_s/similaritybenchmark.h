@@ -0,0 +1,14 @@
+#ifndef SIMILARITYBENCHMARK_H
+#define SIMILARITYBENCHMARK_H
+
+// 人脸比对内核对比，命令行运行：RacePulse_s --bench-similarity [模板数，默认 100000]
+// 随机生成已归一化的 512 维模板，对 CPU 支持的每个实现（AVX-512、AVX2、标量）分别在
+// 1、10（每个用户 K 个模板的 1:1 验证）、1000（缓存内）与指定数量的模板集上输出每次调用与每个模板的耗时、
+// 内存带宽，并核对结果与标量实现一致；模板少时重复多轮，保证计时稳定
+class SimilarityBenchmark
+{
+public:
+    static int run(int templateCount);
+};
+
+#endif // SIMILARITYBENCHMARK_H
@@ -0,0 +1,148 @@
+#include "timingwheel.h"
+
+TimingWheel::TimingWheel(int tickMs, QObject* parent)
+    : QObject(parent)
+    , tickMs(qMax(1, tickMs))
+    , ticker(new QTimer(this))
+{
+    clock.start();
+    connect(ticker, &QTimer::timeout, this, &TimingWheel::onTick);
+}
+
+TimingWheel::~TimingWheel()
+{
+}
+
+TimingWheel::TimerId TimingWheel::schedule(qint64 delayMs, Callback callback)
+{
+    // 空闲时定时器已停止，重新对齐到当前时间
+    if (entries.isEmpty())
+    {
+        currentTick = quint64(clock.elapsed() / tickMs);
+    }
+
+    // 按实际时间向上取整到 tick，保证不会提前触发；至少在下一个 tick 触发
+    const qint64 dueMs = clock.elapsed() + qMax<qint64>(0, delayMs);
+    const quint64 expireTick = qMax(currentTick + 1, quint64((dueMs + tickMs - 1) / tickMs));
+
+    const TimerId id = nextId++;
+    entries.insert(id, Entry{expireTick, std::move(callback)});
+    place(id, expireTick);
+
+    if (!ticker->isActive())
+    {
+        ticker->start(tickMs);
+    }
+    return id;
+}
+
+void TimingWheel::cancel(TimerId id)
+{
+    entries.remove(id);
+    if (entries.isEmpty())
+    {
+        ticker->stop();
+    }
+}
+
+qint64 TimingWheel::now() const
+{
+    return clock.elapsed();
+}
+
+int TimingWheel::size() const
+{
+    return entries.size();
+}
+
+void TimingWheel::onTick()
+{
+    // QTimer 可能延迟，按实际流逝时间补齐错过的 tick
+    const quint64 targetTick = quint64(clock.elapsed() / tickMs);
+    while (currentTick < targetTick && !entries.isEmpty())
+    {
+        ++currentTick;
+
+        // 低层转满一圈时，把高层对应槽中的定时项下沉；先处理高层，保证下沉的项能继续下沉
+        int level = 0;
+        while (level + 1 < LEVELS && (currentTick & ((quint64(1) << (SLOT_BITS * (level + 1))) - 1)) == 0)
+        {
+            ++level;
+        }
+        for (; level > 0; --level)
+        {
+            cascade(level);
+        }
+
+        fireSlot();
+    }
+
+    if (entries.isEmpty())
+    {
+        ticker->stop();
+    }
+    else
+    {
+        currentTick = qMax(currentTick, targetTick);
+    }
+}
+
+void TimingWheel::place(TimerId id, quint64 expireTick)
+{
+    const quint64 delta = expireTick > currentTick ? expireTick - currentTick : 0;
+
+    // 距离到期越远放在越高的层，超出最高层范围的放在最高层，下沉时重新计算
+    int level = 0;
+    while (level + 1 < LEVELS && delta >= (quint64(1) << (SLOT_BITS * (level + 1))))
+    {
+        ++level;
+    }
+
+    quint64 slotTick = expireTick;
+    if (level == LEVELS - 1 && delta >= (quint64(1) << (SLOT_BITS * LEVELS)))
+    {
+        slotTick = currentTick + (quint64(1) << (SLOT_BITS * LEVELS)) - 1;
+    }
+
+    wheel[level][(slotTick >> (SLOT_BITS * level)) & SLOT_MASK].append(id);
+}
+
+void TimingWheel::cascade(int level)
+{
+    QList<TimerId> ids;
+    ids.swap(wheel[level][(currentTick >> (SLOT_BITS * level)) & SLOT_MASK]);
+
+    for (TimerId id : ids)
+    {
+        auto it = entries.constFind(id);
+        if (it != entries.constEnd())
+        {
+            place(id, it->expireTick);
+        }
+    }
+}
+
+void TimingWheel::fireSlot()
+{
+    QList<TimerId> ids;
+    ids.swap(wheel[0][currentTick & SLOT_MASK]);
+
+    for (TimerId id : ids)
+    {
+        auto it = entries.find(id);
+        if (it == entries.end())
+        {
+            continue; // 已取消
+        }
+        if (it->expireTick > currentTick)
+        {
+            place(id, it->expireTick); // 超出最高层范围的项，尚未到期
+            continue;
+        }
+
+        // 先移除再回调，回调中可以安全地重新 schedule 或 cancel
+        Callback callback = std::move(it->callback);
+        entries.erase(it);
+        callback();
+    }
+}
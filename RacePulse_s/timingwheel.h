@@ -0,0 +1,64 @@
+#ifndef TIMINGWHEEL_H
+#define TIMINGWHEEL_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+#include <functional>
+
+// 分层时间轮，每个反应器线程一个，替代每个连接各自的 QTimer
+// 每层 64 个槽，第 0 层精度为一个 tick，高层的定时项在低层转满一圈时下沉；
+// 添加与取消都是 O(1)，所有定时项共用一个 QTimer，没有定时项时停止
+// 非线程安全，只能在所属线程中使用
+class TimingWheel : public QObject
+{
+    Q_OBJECT
+
+public:
+    using TimerId = quint64;
+    using Callback = std::function<void()>;
+
+    explicit TimingWheel(int tickMs = 500, QObject* parent = nullptr);
+    ~TimingWheel();
+
+    TimerId schedule(qint64 delayMs, Callback callback);
+    void cancel(TimerId id);
+
+    qint64 now() const; // 单调时钟（ms），供连接记录最近活动时间
+    int size() const;
+
+private slots:
+    void onTick();
+
+private:
+    void place(TimerId id, quint64 expireTick);
+    void cascade(int level);
+    void fireSlot();
+
+private:
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOT_COUNT = 1 << SLOT_BITS;
+    static constexpr int SLOT_MASK = SLOT_COUNT - 1;
+    static constexpr int LEVELS = 4; // 500ms 精度下可覆盖约 97 天
+
+    struct Entry
+    {
+        quint64 expireTick;
+        Callback callback;
+    };
+
+    int tickMs;
+    quint64 currentTick = 0;
+    TimerId nextId = 1;
+
+    QHash<TimerId, Entry> entries; // 已取消的定时项直接从这里删除，槽中残留的 id 到期时跳过
+    QList<TimerId> wheel[LEVELS][SLOT_COUNT];
+
+    QTimer* ticker;
+    QElapsedTimer clock;
+};
+
+#endif // TIMINGWHEEL_H
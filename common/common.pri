@@ -0,0 +1,8 @@
+# 客户端与服务端共用的协议编解码模块
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/framecodec.cpp
+
+HEADERS += \
+    $$PWD/framecodec.h
@@ -0,0 +1,567 @@
+#include "framecodec.h"
+
+#include <QCborMap>
+#include <QCborValue>
+#include <QJsonDocument>
+#include <QSettings>
+#include <QtEndian>
+
+#include <cstring>
+
+QByteArray Message::binary(const QString& name) const
+{
+    auto it = attachments.constFind(name);
+    if (it != attachments.constEnd())
+    {
+        return it.value();
+    }
+    return QByteArray::fromBase64(json[name].toString().toLatin1());
+}
+
+QByteArray FrameCodec::encode(const QJsonObject& json, const CodecOptions& options, const Attachments& attachments)
+{
+    if (options.version < PROTOCOL_V2)
+    {
+        // v1 依赖缩进格式结尾的 "\n}\n" 与 "END" 组成分隔符
+        if (attachments.isEmpty())
+        {
+            return QJsonDocument(json).toJson(QJsonDocument::Indented) + "END";
+        }
+
+        QJsonObject inlined = json;
+        for (auto it = attachments.constBegin(); it != attachments.constEnd(); ++it)
+        {
+            inlined[it.key()] = QString::fromLatin1(it.value().toBase64());
+        }
+        return QJsonDocument(inlined).toJson(QJsonDocument::Indented) + "END";
+    }
+
+    quint8 flags = attachments.isEmpty() ? 0 : FRAME_FLAG_ATTACHMENTS;
+    QByteArray payload = encodePayload(json, options.encoding, attachments);
+
+    // 超过阈值才压缩，压缩后没有变小（如 PNG 附件）则仍发送原始数据
+    if (options.compression == Compression::Zlib && payload.size() >= options.compressThreshold)
+    {
+        QByteArray packed = qCompress(payload);
+        if (packed.size() < payload.size())
+        {
+            payload = std::move(packed);
+            flags |= FRAME_FLAG_COMPRESSED;
+        }
+    }
+
+    QByteArray frame;
+    frame.reserve(FRAME_HEADER_SIZE + payload.size());
+    frame += encodeHeader(flags, quint16(options.encoding), quint32(payload.size()));
+    frame += payload;
+    return frame;
+}
+
+QByteArray FrameCodec::encodePayload(const QJsonObject& json, FrameType type, const Attachments& attachments)
+{
+    QByteArray body = encodeBody(json, type);
+    if (attachments.isEmpty())
+    {
+        return body;
+    }
+
+    // 先算出总长度，负载只分配一次
+    qsizetype payloadSize = 4 + body.size() + 2;
+    for (auto it = attachments.constBegin(); it != attachments.constEnd(); ++it)
+    {
+        payloadSize += 2 + it.key().toUtf8().size() + 4 + it.value().size();
+    }
+
+    QByteArray payload;
+    payload.reserve(payloadSize);
+
+    uchar field[4];
+    qToBigEndian<quint32>(quint32(body.size()), field);
+    payload.append(reinterpret_cast<const char*>(field), 4);
+    payload += body;
+
+    qToBigEndian<quint16>(quint16(attachments.size()), field);
+    payload.append(reinterpret_cast<const char*>(field), 2);
+    for (auto it = attachments.constBegin(); it != attachments.constEnd(); ++it)
+    {
+        const QByteArray name = it.key().toUtf8();
+        qToBigEndian<quint16>(quint16(name.size()), field);
+        payload.append(reinterpret_cast<const char*>(field), 2);
+        payload += name;
+
+        qToBigEndian<quint32>(quint32(it.value().size()), field);
+        payload.append(reinterpret_cast<const char*>(field), 4);
+        payload += it.value();
+    }
+    return payload;
+}
+
+QByteArray FrameCodec::encodeHeader(quint8 flags, quint16 type, quint32 length)
+{
+    QByteArray header(FRAME_HEADER_SIZE, Qt::Uninitialized);
+    uchar* p = reinterpret_cast<uchar*>(header.data());
+    qToBigEndian<quint16>(FRAME_MAGIC, p);
+    p[2] = quint8(PROTOCOL_V2);
+    p[3] = flags;
+    qToBigEndian<quint16>(type, p + 4);
+    qToBigEndian<quint16>(0, p + 6);
+    qToBigEndian<quint32>(length, p + 8);
+    return header;
+}
+
+bool FrameCodec::decode(const Frame& frame, Message& message)
+{
+    message.attachments.clear();
+    message.storage = frame.payload;
+
+    if (frame.flags & FRAME_FLAG_COMPRESSED)
+    {
+        // qCompress 格式前 4 字节为原始长度，先校验再解压
+        if (frame.payload.size() < 4 ||
+            qFromBigEndian<quint32>(frame.payload.constData()) > MAX_FRAME_PAYLOAD)
+        {
+            return false;
+        }
+        message.storage = qUncompress(frame.payload);
+        if (message.storage.isEmpty())
+        {
+            return false;
+        }
+    }
+
+    if (!(frame.flags & FRAME_FLAG_ATTACHMENTS))
+    {
+        return decodeBody(message.storage, frame.type, message.json);
+    }
+
+    // 逐段校验长度，附件以 fromRawData 引用负载，不做拷贝
+    const uchar* data = reinterpret_cast<const uchar*>(message.storage.constData());
+    const qsizetype size = message.storage.size();
+    qsizetype offset = 0;
+
+    if (size < 4)
+    {
+        return false;
+    }
+    const quint32 bodySize = qFromBigEndian<quint32>(data);
+    offset = 4;
+    if (size - offset < qsizetype(bodySize) + 2)
+    {
+        return false;
+    }
+    const QByteArray body = QByteArray::fromRawData(message.storage.constData() + offset, bodySize);
+    if (!decodeBody(body, frame.type, message.json))
+    {
+        return false;
+    }
+    offset += bodySize;
+
+    const quint16 count = qFromBigEndian<quint16>(data + offset);
+    offset += 2;
+    for (quint16 i = 0; i < count; ++i)
+    {
+        if (size - offset < 2)
+        {
+            return false;
+        }
+        const quint16 nameSize = qFromBigEndian<quint16>(data + offset);
+        offset += 2;
+        if (size - offset < qsizetype(nameSize) + 4)
+        {
+            return false;
+        }
+        const QString name = QString::fromUtf8(message.storage.constData() + offset, nameSize);
+        offset += nameSize;
+
+        const quint32 dataSize = qFromBigEndian<quint32>(data + offset);
+        offset += 4;
+        if (size - offset < qsizetype(dataSize))
+        {
+            return false;
+        }
+        message.attachments.insert(name, QByteArray::fromRawData(message.storage.constData() + offset, dataSize));
+        offset += dataSize;
+    }
+    return true;
+}
+
+QByteArray FrameCodec::encodeBody(const QJsonObject& json, FrameType type)
+{
+    return (type == FrameType::Cbor)
+               ? QCborMap::fromJsonObject(json).toCborValue().toCbor()
+               : QJsonDocument(json).toJson(QJsonDocument::Compact);
+}
+
+bool FrameCodec::decodeBody(const QByteArray& body, quint16 type, QJsonObject& json)
+{
+    if (type == quint16(FrameType::Cbor))
+    {
+        QCborParserError error;
+        const QCborValue value = QCborValue::fromCbor(body, &error);
+        if (error.error != QCborError::NoError || !value.isMap())
+        {
+            return false;
+        }
+        json = value.toMap().toJsonObject();
+        return true;
+    }
+
+    if (type != quint16(FrameType::Json))
+    {
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(body);
+    if (doc.isNull() || !doc.isObject())
+    {
+        return false;
+    }
+    json = doc.object();
+    return true;
+}
+
+FrameType FrameCodec::preferredEncoding()
+{
+    return encodingFromName(QSettings().value("protocol/encoding", "cbor").toString());
+}
+
+QJsonArray FrameCodec::offeredEncodings()
+{
+    // 按优先级排列，JSON 始终作为兜底
+    QJsonArray encodings;
+    if (preferredEncoding() == FrameType::Cbor)
+    {
+        encodings.append(encodingName(FrameType::Cbor));
+    }
+    encodings.append(encodingName(FrameType::Json));
+    return encodings;
+}
+
+FrameType FrameCodec::negotiateEncoding(const QJsonArray& offered)
+{
+    // 按对方的优先级选择第一个本端也愿意使用的编码
+    const FrameType preferred = preferredEncoding();
+    for (const QJsonValue& value : offered)
+    {
+        const QString name = value.toString();
+        if (name == encodingName(FrameType::Cbor) && preferred == FrameType::Cbor)
+        {
+            return FrameType::Cbor;
+        }
+        if (name == encodingName(FrameType::Json))
+        {
+            return FrameType::Json;
+        }
+    }
+    return FrameType::Json;
+}
+
+QString FrameCodec::encodingName(FrameType type)
+{
+    return type == FrameType::Cbor ? QStringLiteral("cbor") : QStringLiteral("json");
+}
+
+FrameType FrameCodec::encodingFromName(const QString& name)
+{
+    return name == QLatin1String("cbor") ? FrameType::Cbor : FrameType::Json;
+}
+
+QJsonArray FrameCodec::offeredCompressions()
+{
+    QJsonArray compressions;
+    if (compressionFromName(QSettings().value("protocol/compression", "zlib").toString()) == Compression::Zlib)
+    {
+        compressions.append(compressionName(Compression::Zlib));
+    }
+    return compressions;
+}
+
+Compression FrameCodec::negotiateCompression(const QJsonArray& offered)
+{
+    // 双方都支持才启用
+    const QJsonArray supported = offeredCompressions();
+    for (const QJsonValue& value : offered)
+    {
+        if (supported.contains(value))
+        {
+            return compressionFromName(value.toString());
+        }
+    }
+    return Compression::None;
+}
+
+QString FrameCodec::compressionName(Compression compression)
+{
+    return compression == Compression::Zlib ? QStringLiteral("zlib") : QStringLiteral("none");
+}
+
+Compression FrameCodec::compressionFromName(const QString& name)
+{
+    return name == QLatin1String("zlib") ? Compression::Zlib : Compression::None;
+}
+
+int FrameCodec::compressThreshold()
+{
+    return QSettings().value("protocol/compress_threshold", CodecOptions().compressThreshold).toInt();
+}
+
+FrameDecoder::FrameDecoder()
+{
+    // 构建分隔符的 KMP 失配表
+    failure[0] = 0;
+    int k = 0;
+    for (int i = 1; i < FRAME_DELIMITER_SIZE; ++i)
+    {
+        while (k > 0 && FRAME_DELIMITER[i] != FRAME_DELIMITER[k])
+        {
+            k = failure[k - 1];
+        }
+        if (FRAME_DELIMITER[i] == FRAME_DELIMITER[k])
+        {
+            ++k;
+        }
+        failure[i] = k;
+    }
+}
+
+void FrameDecoder::append(const QByteArray& data)
+{
+    if (data.isEmpty())
+    {
+        return;
+    }
+    chunks.push_back(data);
+    totalBytes += data.size();
+}
+
+bool FrameDecoder::nextFrame(Frame& frame)
+{
+    if (corrupted || totalBytes == 0)
+    {
+        return false;
+    }
+
+    // 帧开头是 magic 则按 v2 解析，v1 扫描途中不再切换
+    if (scanned == 0)
+    {
+        char magic[2];
+        if (!peek(magic, 2))
+        {
+            return false; // 只收到一个字节，等待更多数据
+        }
+        if (qFromBigEndian<quint16>(magic) == FRAME_MAGIC)
+        {
+            return nextV2Frame(frame);
+        }
+    }
+    return nextV1Frame(frame);
+}
+
+bool FrameDecoder::isCorrupted() const
+{
+    return corrupted;
+}
+
+bool FrameDecoder::nextV1Frame(Frame& frame)
+{
+    qsizetype frameEnd = 0;
+    if (!scanDelimiter(frameEnd))
+    {
+        return false; // 未找到完整消息，等待更多数据
+    }
+
+    // frameEnd 指向分隔符末尾，帧内容不包含最后的 "END"
+    frame.version = PROTOCOL_V1;
+    frame.flags = 0;
+    frame.type = quint16(FrameType::Json);
+    frame.payload = take(frameEnd - FRAME_TRAILER_SIZE);
+    skip(FRAME_TRAILER_SIZE);
+    resetScan();
+    return true;
+}
+
+bool FrameDecoder::nextV2Frame(Frame& frame)
+{
+    char header[FRAME_HEADER_SIZE];
+    if (!peek(header, FRAME_HEADER_SIZE))
+    {
+        return false; // 帧头未收全
+    }
+
+    const uchar* p = reinterpret_cast<const uchar*>(header);
+    const int version = p[2];
+    const quint32 length = qFromBigEndian<quint32>(p + 8);
+    if (version < PROTOCOL_V2 || length > MAX_FRAME_PAYLOAD)
+    {
+        corrupted = true;
+        return false;
+    }
+
+    // 负载未收全时不做任何处理，收全后一次取出
+    if (totalBytes < FRAME_HEADER_SIZE + qsizetype(length))
+    {
+        return false;
+    }
+
+    frame.version = version;
+    frame.flags = p[3];
+    frame.type = qFromBigEndian<quint16>(p + 4);
+    skip(FRAME_HEADER_SIZE);
+    frame.payload = take(length);
+    resetScan();
+    return true;
+}
+
+qsizetype FrameDecoder::bufferedBytes() const
+{
+    return totalBytes;
+}
+
+void FrameDecoder::clear()
+{
+    corrupted = false;
+    chunks.clear();
+    headOffset = 0;
+    totalBytes = 0;
+    resetScan();
+}
+
+bool FrameDecoder::scanDelimiter(qsizetype& frameEnd)
+{
+    // 从上次停下的位置继续扫描，已扫描过的字节不再重复检查
+    while (scanChunk < chunks.size())
+    {
+        const QByteArray& chunk = chunks[scanChunk];
+        const char* data = chunk.constData();
+        const qsizetype size = chunk.size();
+
+        while (scanOffset < size)
+        {
+            const char c = data[scanOffset++];
+            ++scanned;
+
+            while (matched > 0 && c != FRAME_DELIMITER[matched])
+            {
+                matched = failure[matched - 1];
+            }
+            if (c == FRAME_DELIMITER[matched])
+            {
+                ++matched;
+            }
+            if (matched == FRAME_DELIMITER_SIZE)
+            {
+                frameEnd = scanned;
+                return true;
+            }
+        }
+
+        ++scanChunk;
+        scanOffset = 0;
+    }
+
+    // 停在最后一块末尾，新数据到达后从新块开头继续
+    if (!chunks.empty())
+    {
+        scanChunk = chunks.size() - 1;
+        scanOffset = chunks.back().size();
+    }
+    return false;
+}
+
+bool FrameDecoder::peek(char* out, qsizetype length) const
+{
+    if (totalBytes < length)
+    {
+        return false;
+    }
+
+    qsizetype offset = headOffset;
+    for (const QByteArray& chunk : chunks)
+    {
+        const qsizetype n = qMin(length, chunk.size() - offset);
+        memcpy(out, chunk.constData() + offset, n);
+        out += n;
+        length -= n;
+        offset = 0;
+        if (length == 0)
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+QByteArray FrameDecoder::take(qsizetype length)
+{
+    length = qMin(length, totalBytes);
+    if (length <= 0)
+    {
+        return QByteArray();
+    }
+
+    // 整块恰好是一帧时直接转移，不做拷贝
+    QByteArray& head = chunks.front();
+    if (headOffset == 0 && head.size() == length)
+    {
+        QByteArray frame = std::move(head);
+        chunks.pop_front();
+        totalBytes -= length;
+        return frame;
+    }
+
+    // 帧只落在首块内
+    if (head.size() - headOffset >= length)
+    {
+        QByteArray frame(head.constData() + headOffset, length);
+        skip(length);
+        return frame;
+    }
+
+    // 帧跨越多个块，一次分配后依次拷入
+    QByteArray frame;
+    frame.reserve(length);
+    qsizetype remaining = length;
+    while (remaining > 0)
+    {
+        const QByteArray& chunk = chunks.front();
+        const qsizetype n = qMin(remaining, chunk.size() - headOffset);
+        frame.append(chunk.constData() + headOffset, n);
+        remaining -= n;
+        skip(n);
+    }
+    return frame;
+}
+
+void FrameDecoder::skip(qsizetype length)
+{
+    length = qMin(length, totalBytes);
+    totalBytes -= length;
+
+    while (length > 0)
+    {
+        const qsizetype available = chunks.front().size() - headOffset;
+        if (length < available)
+        {
+            headOffset += length;
+            return;
+        }
+        // 整块已消费，直接丢弃
+        length -= available;
+        chunks.pop_front();
+        headOffset = 0;
+    }
+
+    if (!chunks.empty() && headOffset == chunks.front().size())
+    {
+        chunks.pop_front();
+        headOffset = 0;
+    }
+}
+
+void FrameDecoder::resetScan()
+{
+    scanChunk = 0;
+    scanOffset = headOffset;
+    scanned = 0;
+    matched = 0;
+}
@@ -0,0 +1,151 @@
+#ifndef FRAMECODEC_H
+#define FRAMECODEC_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+
+#include <deque>
+
+// v1 协议：缩进格式的 JSON 文本，以 "\n}\nEND" 结尾
+// 帧内容为分隔符中 "END" 之前的部分（包含最后的 "\n}\n"）
+inline constexpr char FRAME_DELIMITER[] = "\n}\nEND";
+inline constexpr int FRAME_DELIMITER_SIZE = 6;
+inline constexpr int FRAME_TRAILER_SIZE = 3; // "END"
+
+// v2 协议：定长帧头 + 负载，帧头为网络字节序
+// | magic(2) | version(1) | flags(1) | type(2) | reserved(2) | length(4) |
+// v1 帧总是以 '{' 开头，与 magic 不冲突，接收端按帧自动识别
+inline constexpr quint16 FRAME_MAGIC = 0x5250; // "RP"
+inline constexpr int FRAME_HEADER_SIZE = 12;
+inline constexpr quint32 MAX_FRAME_PAYLOAD = 64 * 1024 * 1024;
+
+inline constexpr int PROTOCOL_V1 = 1;
+inline constexpr int PROTOCOL_V2 = 2;
+inline constexpr int PROTOCOL_LATEST = PROTOCOL_V2;
+
+// 负载类型
+enum class FrameType : quint16
+{
+    Json = 1, // 紧凑格式 JSON 文本，便于抓包调试
+    Cbor = 2  // CBOR 二进制编码
+};
+
+// 帧头 flags
+// 带附件时负载为：| 主体长度(4) | 主体 | 附件数(2) | { 名称长度(2) | 名称 | 数据长度(4) | 数据 } ... |
+// 图片等二进制数据不再 Base64 后嵌入 JSON，接收端直接引用接收缓冲
+inline constexpr quint8 FRAME_FLAG_ATTACHMENTS = 0x01;
+// 负载经过压缩，压缩前的长度由压缩数据自带（qCompress 格式），解压时一次分配
+inline constexpr quint8 FRAME_FLAG_COMPRESSED = 0x02;
+
+// 压缩算法，目前只有 zlib，后续可增加更快的实现
+enum class Compression
+{
+    None,
+    Zlib
+};
+
+// 与对端协商后的编码参数
+struct CodecOptions
+{
+    int version = PROTOCOL_V1;
+    FrameType encoding = FrameType::Json;
+    Compression compression = Compression::None;
+    int compressThreshold = 1024; // 负载小于该字节数时不压缩，心跳等小消息不受影响
+};
+
+using Attachments = QHash<QString, QByteArray>;
+
+struct Frame
+{
+    int version = PROTOCOL_V1;
+    quint8 flags = 0;
+    quint16 type = quint16(FrameType::Json);
+    QByteArray payload;
+};
+
+// 解码后的消息：JSON 主体 + 二进制附件
+struct Message
+{
+    QJsonObject json;
+    Attachments attachments; // 直接引用帧负载，不做拷贝
+    QByteArray storage;      // 持有帧负载，保证附件有效
+
+    // 取二进制字段，对端使用 v1 时回退为 JSON 中的 Base64 字符串
+    QByteArray binary(const QString& name) const;
+};
+
+// 消息与帧之间的转换
+class FrameCodec
+{
+public:
+    // v1 无法携带附件，附件以 Base64 字符串写入 JSON 的同名字段
+    static QByteArray encode(const QJsonObject& json, const CodecOptions& options,
+                             const Attachments& attachments = Attachments());
+    static QByteArray encodeHeader(quint8 flags, quint16 type, quint32 length);
+    static bool decode(const Frame& frame, Message& message);
+
+    // 负载编码协商，配置项 protocol/encoding 可设为 "json" 以便调试
+    static FrameType preferredEncoding();
+    static QJsonArray offeredEncodings();
+    static FrameType negotiateEncoding(const QJsonArray& offered);
+    static QString encodingName(FrameType type);
+    static FrameType encodingFromName(const QString& name);
+
+    // 压缩协商，配置项 protocol/compression 可设为 "none" 关闭，
+    // protocol/compress_threshold 设置压缩阈值
+    static QJsonArray offeredCompressions();
+    static Compression negotiateCompression(const QJsonArray& offered);
+    static QString compressionName(Compression compression);
+    static Compression compressionFromName(const QString& name);
+    static int compressThreshold();
+
+private:
+    static QByteArray encodeBody(const QJsonObject& json, FrameType type);
+    static QByteArray encodePayload(const QJsonObject& json, FrameType type,
+                                    const Attachments& attachments);
+    static bool decodeBody(const QByteArray& body, quint16 type, QJsonObject& json);
+};
+
+// 增量帧解码器，客户端与服务端共用
+// 接收的数据按块保存，不做整体拼接；v1 帧的扫描位置跨多次 readyRead 保留，
+// 每个字节只扫描一次；v2 帧按帧头长度直接取出，不扫描负载；
+// 取出帧时直接丢弃整块而不移动剩余数据
+class FrameDecoder
+{
+public:
+    FrameDecoder();
+
+    void append(const QByteArray& data);
+    bool nextFrame(Frame& frame); // 取出下一帧，没有完整帧则返回 false
+
+    bool isCorrupted() const; // 收到无法识别的 v2 帧头
+    qsizetype bufferedBytes() const; // 尚未取出的字节数
+    void clear();
+
+private:
+    bool nextV1Frame(Frame& frame);
+    bool nextV2Frame(Frame& frame);
+    bool scanDelimiter(qsizetype& frameEnd);
+    bool peek(char* out, qsizetype length) const;
+    QByteArray take(qsizetype length);
+    void skip(qsizetype length);
+    void resetScan();
+
+private:
+    std::deque<QByteArray> chunks;
+    qsizetype headOffset = 0; // 首块中已消费的字节数
+    qsizetype totalBytes = 0; // 所有块中未消费的字节数
+    bool corrupted = false;
+
+    // 扫描游标
+    size_t scanChunk = 0;     // 当前扫描的块
+    qsizetype scanOffset = 0; // 块内偏移
+    qsizetype scanned = 0;    // 已扫描的未消费字节数
+    int matched = 0;          // 已匹配的分隔符前缀长度
+
+    int failure[FRAME_DELIMITER_SIZE]; // 分隔符的 KMP 失配表
+};
+
+#endif // FRAMECODEC_H